@@ -15,6 +15,7 @@
 <p>The unfolding method can either use the constructors for individual unfolding algorithms or the New() method, specifiying the algorithm to be used.
 <p>The resultant distribution can be displayed as a plot (Hreco) or as a bin by bin breakdown of the true, measured and reconstructed values (PrintTable)
 <p>A covariance matrix can be returned using the Ereco() method. A vector of its diagonals can be returned with the ErecoV() method.
+<p>RooUnfoldSvd, RooUnfoldBinByBin, and RooUnfoldInvert are linear in the measured distribution (IsLinear()). For these, EffectiveMatrix() returns the unfolding matrix, the kCovToy toys are unfolded in batches with a single matrix product (rather than one unfolding per toy), and ExactCov() gives the covariance from the measurement errors without toys.
 <p>A summary of the unfolding algorithms which inherit from this class is below:
 <ul>
 <li>RooUnfoldBayes: Uses the Bayes method of unfolding based on the method written by D'Agostini (<a href="http://www.slac.stanford.edu/spires/find/hep/www?j=NUIMA,A362,487">NIM A 362 (1995) 487</a>).
@@ -80,10 +81,12 @@ END_HTML */
 #include "TDecompSVD.h"
 #include "TDecompChol.h"
 #include "TRandom.h"
+#include "TRandom3.h"
 #include "TMath.h"
 
 #include "RooUnfoldResponse.h"
 #include "RooUnfoldErrors.h"
+#include "RooUnfoldParallel.h"
 // Need subclasses just for RooUnfold::New()
 #include "RooUnfoldBayes.h"
 #include "RooUnfoldSvd.h"
@@ -92,9 +95,7 @@ END_HTML */
 #ifndef NOTUNFOLD
 #include "RooUnfoldTUnfold.h"
 #endif
-#ifdef HAVE_DAGOSTINI
 #include "RooUnfoldDagostini.h"
-#endif
 
 using std::vector;
 using std::cout;
@@ -107,6 +108,23 @@ using std::fabs;
 
 ClassImp (RooUnfold);
 
+namespace {
+
+  const Int_t NToyBlock= 8;  // toys per task: fixed, so that the sums don't depend on the number of threads
+  const Int_t NToyBatch= 1024;  // toys per matrix product for linear methods
+
+  struct ToyJob {
+    const RooUnfold* unfold;
+    UInt_t           seed;
+    Int_t            ntoys;
+    Int_t            nt;
+    vector<Int_t>    n;       // running statistics for each block of toys
+    vector<TVectorD> mean;
+    vector<TMatrixD> comom;
+  };
+
+}
+
 RooUnfold::RooUnfold (const RooUnfoldResponse* res, const TH1* meas, const char* name, const char* title)
   : TNamed (name, title)
 {
@@ -154,13 +172,8 @@ RooUnfold* RooUnfold::New (Algorithm alg, const RooUnfoldResponse* res, const TH
       unfold = new RooUnfoldInvert  (res,meas);
       break;
     case kDagostini:
-#ifdef HAVE_DAGOSTINI
       unfold = new RooUnfoldDagostini (res,meas);
       break;
-#else
-      cerr << "RooUnfoldDagostini is not available" << endl;
-      return 0;
-#endif
     default:
       cerr << "Unknown RooUnfold method " << Int_t(alg) << endl;
       return 0;
@@ -212,12 +225,22 @@ void RooUnfold::CopyData (const RooUnfold& rhs)
   Setup (rhs.response(), rhs.Hmeasured());
   SetVerbose (rhs.verbose());
   SetNToys   (rhs.NToys());
+  SetRandomGenerator (rhs.RandomGenerator());
+  SetToyThreads (rhs.ToyThreads());
+  SetToySeed (rhs.ToySeed());
+  IncludeSystematics (rhs.SystematicsIncluded());
 }
 
 void RooUnfold::Reset()
 {
+  TRandom* rnd= _rnd;  // keep generator, toy threads, and toy seed across Setup()
+  Int_t nthreads= _nthreads;
+  UInt_t toyseed= _toyseed;
   Destroy();
   Init();
+  _rnd= rnd;
+  _nthreads= nthreads;
+  _toyseed= toyseed;
 }
 
 void RooUnfold::Init()
@@ -232,6 +255,9 @@ void RooUnfold::Init()
   _dosys= _unfolded= _haveCov= _haveCovMes= _fail= _have_err_mat= _haveErrors= _haveWgt= false;
   _withError= kDefault;
   _NToys=50;
+  _rnd= 0;
+  _nthreads= 0;
+  _toyseed= 0;
   GetSettings();
 }
 
@@ -380,26 +406,237 @@ void RooUnfold::GetErrMat()
   // Get covariance matrix from the variation of the results in toy MC tests
   if (_NToys<=1) return;
   _err_mat.ResizeTo(_nt,_nt);
-  TVectorD xisum (_nt);
-  TMatrixD xijsum(_nt,_nt);
-  for (Int_t k=0; k<_NToys; k++){
-    RooUnfold* unfold= RunToy();
-    const TVectorD& x= unfold->Vreco();
-    for (Int_t i=0; i<_nt;i++){
-      Double_t xi= x[i];
-      xisum[i] += xi;
-      for (Int_t j=0; j<_nt; j++) xijsum(i,j) += xi * x[j];
+  if (!_dosys) {
+    TMatrixD m;
+    if (EffectiveMatrix (m)) {
+      GetErrMatLinear (m);
+      return;
     }
-    delete unfold;
   }
-  for (Int_t i=0; i<_nt; i++){
-    for (Int_t j=0; j<_nt; j++){
-      _err_mat(i,j)= (xijsum(i,j) - (xisum[i]*xisum[j])/_NToys) / (_NToys-1);
+  Int_t    ntoy= 0;
+  TVectorD mean (_nt);
+  TMatrixD comom(_nt,_nt);
+  if (_nthreads>0 || _toyseed) {
+
+    // Blocks of toys (on several threads), each toy with its own generator.
+    // Fill the response's caches now, so that the toys only read it.
+    _res->Vmeasured(); _res->Emeasured(); _res->Vfakes();
+    _res->Vtruth();    _res->Etruth();    _res->Mresponse(); _res->Eresponse();
+    TRandom* rnd= _rnd ? _rnd : gRandom;
+    ToyJob job;
+    job.unfold= this;
+    job.seed=   _toyseed ? _toyseed : UInt_t(rnd->Integer(kMaxUInt));
+    job.ntoys=  _NToys;
+    job.nt=     _nt;
+    Int_t nblock= (_NToys + NToyBlock - 1) / NToyBlock;
+    job.n    .assign (nblock, 0);
+    job.mean .assign (nblock, TVectorD(_nt));
+    job.comom.assign (nblock, TMatrixD(_nt,_nt));
+    Bool_t oldstat= TH1::AddDirectoryStatus();
+    TH1::AddDirectory (kFALSE);
+    RooUnfoldParallel::Run (nblock, ToyTask, &job, _nthreads>0 ? _nthreads : 1);
+    TH1::AddDirectory (oldstat);
+
+    // Pairwise reduction in a fixed order
+    for (Int_t step= 1; step<nblock; step *= 2) {
+      for (Int_t b= 0; b+step<nblock; b += 2*step) {
+        MergeToys (job.n[b], job.mean[b], job.comom[b], job.n[b+step], job.mean[b+step], job.comom[b+step]);
+      }
     }
+    ntoy=  job.n    [0];
+    mean=  job.mean [0];
+    comom= job.comom[0];
+
+  } else {
+
+    // The toy response matrix (if any) is refilled for each toy.
+    TRandom* rnd= _rnd ? _rnd : gRandom;
+    RooUnfoldResponse* toyres= _dosys ? new RooUnfoldResponse() : 0;
+    for (Int_t k=0; k<_NToys; k++){
+      RooUnfold* unfold= RunToy (rnd, toyres);
+      AddToy (ntoy, mean, comom, unfold->Vreco());
+      delete unfold;
+    }
+    delete toyres;
+
   }
+  _err_mat= comom;
+  _err_mat *= 1.0/(ntoy-1);
   _have_err_mat=true;
 }
 
+void RooUnfold::GetErrMatLinear (const TMatrixD& m)
+{
+  // kCovToy covariance for a method with unfolding matrix m (see EffectiveMatrix()).
+  // The toys smear the measured distribution exactly as RunToy() does (with the same random
+  // numbers), but instead of unfolding each toy, a batch of toys is put in the columns of
+  // one matrix and unfolded with a single matrix product.
+  TRandom* rnd= _rnd ? _rnd : gRandom;
+  Bool_t streams= _nthreads>0 || _toyseed;
+  UInt_t seed= 0;
+  if (streams) seed= _toyseed ? _toyseed : UInt_t(rnd->Integer(kMaxUInt));
+  const TVectorD& err= Emeasured();
+  const TMatrixD* covL= _haveCovMes ? &MeasuredCovL() : 0;
+  Int_t    ntoy= 0;
+  TVectorD mean (_nt);
+  TMatrixD comom(_nt,_nt);
+  TRandom3 rnd3;
+  for (Int_t k0= 0; k0<_NToys; k0 += NToyBatch) {
+    Int_t nb= _NToys-k0 < NToyBatch ? _NToys-k0 : NToyBatch;
+    TMatrixD noise (_nm, nb);
+    for (Int_t k= 0; k<nb; k++) {
+      TRandom* r= rnd;
+      if (streams) {
+        rnd3.SetSeed (RooUnfoldParallel::Seed (seed, k0+k));
+        r= &rnd3;
+      }
+      if (covL) {
+        TVectorD z(_nm);
+        for (Int_t i= 0; i<_nm; i++) z[i]= r->Gaus(0.0,1.0);
+        z *= *covL;
+        for (Int_t i= 0; i<_nm; i++) noise(i,k)= z[i];
+      } else {
+        for (Int_t i= 0; i<_nm; i++) {
+          Double_t e= err[i];
+          if (e>0.0) noise(i,k)= r->Gaus(0,e);
+        }
+      }
+    }
+
+    // Unfold the whole batch, then get its mean and co-moment
+    TMatrixD rec (m, TMatrixD::kMult, noise);
+    TVectorD meanb(_nt);
+    for (Int_t i= 0; i<_nt; i++) {
+      Double_t s= 0.0;
+      for (Int_t k= 0; k<nb; k++) s += rec(i,k);
+      meanb[i]= s/nb;
+      for (Int_t k= 0; k<nb; k++) rec(i,k) -= meanb[i];
+    }
+    TMatrixD comomb (rec, TMatrixD::kMultTranspose, rec);
+    MergeToys (ntoy, mean, comom, nb, meanb, comomb);
+  }
+  _err_mat.ResizeTo(_nt,_nt);
+  _err_mat= comom;
+  _err_mat *= 1.0/(ntoy-1);
+  _have_err_mat=true;
+}
+
+Bool_t RooUnfold::UnfoldRegParms (Int_t /*n*/, const Double_t* /*parms*/, RooUnfold** /*unfolds*/, ErrorTreatment /*withError*/) const
+{
+  // Fill unfolds[0..n-1] with new clones, each already unfolded (with errors withError) with
+  // regularisation parameter parms[i], giving the same results as a separate unfolding with
+  // SetRegParm(parms[i]). Methods that can share work between the parameters (RooUnfoldBayes,
+  // RooUnfoldSvd) override this. Returns false (leaving unfolds unset) if not supported.
+  return kFALSE;
+}
+
+Bool_t RooUnfold::EffectiveMatrix (TMatrixD& /*m*/)
+{
+  // Fill m (nt x nm) with the matrix for which Vreco() = m * Vmeasured(), for the given
+  // response matrix and regularisation. Only available for linear methods (see IsLinear()),
+  // and not when IncludeSystematics() is set. Returns false if not available.
+  return kFALSE;
+}
+
+Bool_t RooUnfold::ExactCov (TMatrixD& cov)
+{
+  // Fill cov with the covariance of the unfolded distribution due to the measurement
+  // errors, propagated through EffectiveMatrix() (as kCovToy would give with infinite toys).
+  // Returns false for non-linear methods.
+  if (_dosys) return kFALSE;
+  TMatrixD m;
+  if (!EffectiveMatrix (m)) return kFALSE;
+  cov.ResizeTo (_nt, _nt);
+  ABAT (m, GetMeasuredCov(), cov);
+  return kTRUE;
+}
+
+TMatrixD RooUnfold::FakesMatrix() const
+{
+  // The unfolding methods subtract the fakes, scaled by the ratio of measured and training
+  // entries, from the measured distribution. As that is linear in the measured distribution,
+  // it can be written as the (nm x nm) matrix 1 - fakes * (1,...,1) / training entries.
+  TMatrixD f (_nm,_nm);
+  f.UnitMatrix();
+  if (!_res->FakeEntries()) return f;
+  Double_t fac= _res->Vmeasured().Sum();
+  if (fac==0.0) return f;
+  const TVectorD& fakes= _res->Vfakes();
+  for (Int_t i= 0; i<_nm; i++)
+    for (Int_t j= 0; j<_nm; j++)
+      f(i,j) -= fakes[i]/fac;
+  return f;
+}
+
+const TMatrixD& RooUnfold::MeasuredCovL() const
+{
+  // _covL is a lower triangular matrix for which the covariance matrix, V = _covL * _covL^T.
+  if (!_covL) {
+    TDecompChol c(*_covMes);
+    c.Decompose();
+    TMatrixD U(c.GetU());
+    _covL= new TMatrixD (TMatrixD::kTransposed, U);
+    if (_verbose>=2) RooUnfoldResponse::PrintMatrix(*_covL,"decomposed measurement covariance matrix");
+  }
+  return *_covL;
+}
+
+void RooUnfold::ToyTask (Int_t iblock, void* arg)
+{
+  // Run one block of kCovToy toys. The toys are made from a private clone (so that its
+  // cached measurement vectors are not shared between threads), with one generator per toy
+  // and one toy response matrix per block.
+  ToyJob* job= (ToyJob*) arg;
+  const RooUnfold* unfold= job->unfold;
+  RooUnfold* worker= unfold->Clone (unfold->GetName());
+  unfold->SetupToy (worker);
+  if (unfold->_haveCovMes) worker->SetMeasuredCov (*unfold->_covMes);
+  RooUnfoldResponse* toyres= unfold->_dosys ? new RooUnfoldResponse() : 0;
+  Int_t kmax= (iblock+1)*NToyBlock;
+  if (kmax > job->ntoys) kmax= job->ntoys;
+  for (Int_t k= iblock*NToyBlock; k<kmax; k++) {
+    TRandom3 rnd (RooUnfoldParallel::Seed (job->seed, k));
+    RooUnfold* toy= worker->RunToy (&rnd, toyres);
+    AddToy (job->n[iblock], job->mean[iblock], job->comom[iblock], toy->Vreco());
+    delete toy;
+  }
+  delete toyres;
+  delete worker;
+}
+
+void RooUnfold::AddToy (Int_t& n, TVectorD& mean, TMatrixD& comom, const TVectorD& x)
+{
+  // Add toy result x to the running mean and co-moment matrix of n toys (Welford's method).
+  // The covariance of the toys is comom/(n-1).
+  Int_t nb= mean.GetNrows();
+  TVectorD delta (x);
+  delta -= mean;
+  n++;
+  for (Int_t i=0; i<nb; i++) mean[i] += delta[i]/n;
+  for (Int_t i=0; i<nb; i++) {
+    Double_t di= delta[i];
+    for (Int_t j=0; j<nb; j++) comom(i,j) += di * (x[j]-mean[j]);
+  }
+}
+
+void RooUnfold::MergeToys (Int_t& n, TVectorD& mean, TMatrixD& comom,
+                           Int_t nb, const TVectorD& meanb, const TMatrixD& comomb)
+{
+  // Combine the running mean and co-moment matrix of n toys with those of another nb toys.
+  if (nb<=0) return;
+  Int_t nsum= n + nb;
+  Int_t nt= mean.GetNrows();
+  TVectorD delta (meanb);
+  delta -= mean;
+  Double_t f= Double_t(n) * Double_t(nb) / nsum;
+  comom += comomb;
+  for (Int_t i=0; i<nt; i++) {
+    for (Int_t j=0; j<nt; j++) comom(i,j) += f * delta[i] * delta[j];
+  }
+  for (Int_t i=0; i<nt; i++) mean[i] += delta[i] * nb / nsum;
+  n= nsum;
+}
+
 Bool_t RooUnfold::UnfoldWithErrors (ErrorTreatment withError, bool getWeights)
 {
   if (!_unfolded) {
@@ -726,27 +963,50 @@ RooUnfold* RooUnfold::RunToy() const
   // Returns new RooUnfold object with smeared measurements and
   // (if IncludeSystematics) response matrix for use as a toy.
   // Use multiple toys to find spread of unfolding results.
+  return RunToy (_rnd ? _rnd : gRandom);
+}
+
+RooUnfold* RooUnfold::RunToyIndex (Int_t k) const
+{
+  // Returns toy number k of the kCovToy toys. With SetToySeed(), this uses the toy's own
+  // generator (as GetErrMat() does), so it can be regenerated on its own (e.g. to look
+  // at an outlier). Otherwise the same as RunToy().
+  if (!_toyseed) return RunToy();
+  TRandom3 rnd (RooUnfoldParallel::Seed (_toyseed, k));
+  return RunToy (&rnd);
+}
+
+RooUnfold* RooUnfold::RunToy (TRandom* rnd) const
+{
+  // Returns new toy as for RunToy(), using the random number generator rnd.
+  return RunToy (rnd, 0);
+}
+
+RooUnfold* RooUnfold::RunToy (TRandom* rnd, RooUnfoldResponse* toyres) const
+{
+  // Returns new toy as for RunToy(), using the random number generator rnd.
+  // If IncludeSystematics, the toy response matrix is refilled in toyres (see
+  // RooUnfoldResponse::RunToy), which the toy then uses without owning it, so toyres
+  // can be reused for the next toy. Pass toyres=0 to make a new toy response, owned by the toy.
   TString name= GetName();
   name += "_toy";
   RooUnfold* unfold = Clone(name);
+  SetupToy (unfold);
 
   // Make new smeared response matrix
-  if (_dosys) unfold->SetResponse (_res->RunToy(), kTRUE);
+  if (_dosys) {
+    if (toyres) unfold->SetResponse (_res->RunToy(rnd,toyres));
+    else        unfold->SetResponse (_res->RunToy(rnd), kTRUE);
+  }
+  // Only the toy's result is used, so don't propagate the response errors in the toy itself.
+  unfold->IncludeSystematics (0);
   if (_dosys==2) return unfold;
 
   if (_haveCovMes) {
 
-    // _covL is a lower triangular matrix for which the covariance matrix, V = _covL * _covL^T.
-    if (!_covL) {
-      TDecompChol c(*_covMes);
-      c.Decompose();
-      TMatrixD U(c.GetU());
-      _covL= new TMatrixD (TMatrixD::kTransposed, U);
-      if (_verbose>=2) RooUnfoldResponse::PrintMatrix(*_covL,"decomposed measurement covariance matrix");
-    }
     TVectorD newmeas(_nm);
-    for (Int_t i= 0; i<_nm; i++) newmeas[i]= gRandom->Gaus(0.0,1.0);
-    newmeas *= *_covL;
+    for (Int_t i= 0; i<_nm; i++) newmeas[i]= rnd->Gaus(0.0,1.0);
+    newmeas *= MeasuredCovL();
     newmeas += Vmeasured();
     unfold->SetMeasured(newmeas,*_covMes);
 
@@ -756,7 +1016,7 @@ RooUnfold* RooUnfold::RunToy() const
     const TVectorD& err= Emeasured();
     for (Int_t i= 0; i<_nm; i++) {
       Double_t e= err[i];
-      if (e>0.0) newmeas[i] += gRandom->Gaus(0,e);
+      if (e>0.0) newmeas[i] += rnd->Gaus(0,e);
     }
     unfold->SetMeasured(newmeas,err);
 
@@ -764,6 +1024,12 @@ RooUnfold* RooUnfold::RunToy() const
   return unfold;
 }
 
+void RooUnfold::SetupToy (RooUnfold* /*toy*/) const
+{
+  // Called on each copy made to run toys (by RunToy, and for each block of threaded toys),
+  // before it is used. Nothing to do by default.
+}
+
 void RooUnfold::Print(Option_t* /*opt*/) const
 {
   cout << ClassName() << "::" << GetName() << " \"" << GetTitle()
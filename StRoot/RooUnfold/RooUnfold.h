@@ -19,6 +19,7 @@
 
 class TH1;
 class TH1D;
+class TRandom;
 
 class RooUnfold : public TNamed {
 
@@ -91,6 +92,8 @@ public:
   virtual Int_t      SystematicsIncluded() const;
   virtual Int_t      NToys() const;         // Number of toys
   virtual void       SetNToys (Int_t toys); // Set number of toys
+  virtual Int_t      ToyThreads() const;    // Number of threads for kCovToy toys
+  virtual void       SetToyThreads (Int_t nthreads); // Set number of threads for kCovToy toys (0 = serial, using RandomGenerator())
   virtual Int_t      Overflow() const;
   virtual void       PrintTable (std::ostream& o, const TH1* hTrue= 0, ErrorTreatment withError=kDefault);
   virtual void       SetRegParm (Double_t parm);
@@ -101,8 +104,24 @@ public:
   Double_t GetStepSizeParm() const;
   Double_t GetDefaultParm() const;
   RooUnfold* RunToy() const;
+  RooUnfold* RunToy (TRandom* rnd) const;  // toy using generator rnd
+  RooUnfold* RunToy (TRandom* rnd, RooUnfoldResponse* toyres) const;  // toy using generator rnd, refilling toy response toyres (if IncludeSystematics)
+  RooUnfold* RunToyIndex (Int_t k) const;  // toy number k (from its own stream if SetToySeed is used)
+  void       SetRandomGenerator (TRandom* rnd); // Generator for toys (not owned; 0 = gRandom)
+  virtual Bool_t IsLinear() const;          // Unfolded result is a linear function of the measured distribution?
+  virtual Bool_t EffectiveMatrix (TMatrixD& m);  // Fill m with the unfolding matrix, Vreco() = m * Vmeasured() (linear methods only)
+  Bool_t     ExactCov (TMatrixD& cov);      // Covariance from the measurement errors via EffectiveMatrix(), without toys
+  virtual Bool_t UnfoldRegParms (Int_t n, const Double_t* parms, RooUnfold** unfolds, ErrorTreatment withError) const; // Unfolded clones for several regularisation parameters, sharing work (where supported)
+  TRandom*   RandomGenerator() const;
+  void       SetToySeed (UInt_t seed);      // Master seed for per-toy random streams (0 = use RandomGenerator())
+  UInt_t     ToySeed() const;
   void Print(Option_t* opt="") const;
 
+  // Running mean and co-moment matrix of toy results (covariance = comom/(n-1))
+  static void AddToy    (Int_t& n, TVectorD& mean, TMatrixD& comom, const TVectorD& x);
+  static void MergeToys (Int_t& n, TVectorD& mean, TMatrixD& comom,
+                         Int_t nb, const TVectorD& meanb, const TMatrixD& comomb);
+
   static void PrintTable (std::ostream& o, const TH1* hTrainTrue, const TH1* hTrain,
                           const TH1* hTrue, const TH1* hMeas, const TH1* hReco,
                           Int_t _nm=0, Int_t _nt=0, Bool_t _overflow=kFALSE,
@@ -122,6 +141,11 @@ protected:
   virtual void GetSettings();
   virtual Bool_t UnfoldWithErrors (ErrorTreatment withError, bool getWeights=false);
 
+  virtual void GetErrMatLinear (const TMatrixD& m); // kCovToy toys propagated through the unfolding matrix m
+  virtual void SetupToy (RooUnfold* toy) const;     // Prepare a copy made to run toys (see RunToy)
+  TMatrixD FakesMatrix() const;   // Linear map which subtracts the scaled fakes from the measured distribution
+  const TMatrixD& MeasuredCovL() const; // Cached lower triangular L with _covMes = L * L^T
+
   static TMatrixD CutZeros     (const TMatrixD& ereco);
   static TH1D*    HistNoOverflow (const TH1* h, Bool_t overflow);
   static TMatrixD& ABAT (const TMatrixD& a, const TMatrixD& b, TMatrixD& c);
@@ -130,6 +154,7 @@ protected:
   static Int_t    InvertMatrix (const TMatrixD& mat, TMatrixD& inv, const char* name="matrix", Int_t verbose=1);
 
 private:
+  static void ToyTask (Int_t itask, void* arg);
   void Init();
   void Destroy();
   void CopyData (const RooUnfold& rhs);
@@ -167,6 +192,9 @@ protected:
   mutable TMatrixD* _covMes;       // Measurement covariance matrix
   mutable TMatrixD* _covL; //! Cached lower triangular matrix for which _covMes = _covL * _covL^T.
   ErrorTreatment _withError; // type of error last calulcated
+  TRandom* _rnd;           //! Random number generator for toys (not owned; 0 = gRandom)
+  Int_t    _nthreads;      //! Number of threads for kCovToy toys (0 = serial, using _rnd)
+  UInt_t   _toyseed;       //! Master seed for per-toy random streams (0 = from _rnd)
 
 public:
 
@@ -296,6 +324,23 @@ void  RooUnfold::SetNToys (Int_t toys)
   _NToys= toys;
 }
 
+inline
+void  RooUnfold::SetToyThreads (Int_t nthreads)
+{
+  // Run the kCovToy toys on nthreads threads. Each toy then gets its own generator, seeded from
+  // ToySeed() (or one number drawn from RandomGenerator() or gRandom) and the toy number, so the
+  // results don't depend on nthreads (but differ from the serial toys, which share RandomGenerator()).
+  // 0 (the default) runs the toys serially with RandomGenerator(), unless SetToySeed() is used.
+  _nthreads= nthreads > 0 ? nthreads : 0;
+}
+
+inline
+Int_t RooUnfold::ToyThreads() const
+{
+  // Number of threads for kCovToy toys (0 = serial, using RandomGenerator()).
+  return _nthreads;
+}
+
 inline
 void  RooUnfold::SetRegParm (Double_t)
 {
@@ -318,6 +363,47 @@ void RooUnfold::IncludeSystematics (Int_t dosys)
   _dosys= dosys;
 }
 
+inline
+void RooUnfold::SetRandomGenerator (TRandom* rnd)
+{
+  // Set random number generator used for toys (not owned). 0 uses gRandom.
+  // Give each unfolding object its own generator to run toys from several threads.
+  _rnd= rnd;
+}
+
+inline
+TRandom* RooUnfold::RandomGenerator() const
+{
+  // Random number generator used for toys (0 = gRandom).
+  return _rnd;
+}
+
+inline
+void RooUnfold::SetToySeed (UInt_t seed)
+{
+  // Give toy number k its own generator, seeded with RooUnfoldParallel::Seed(seed,k), whether the
+  // toys run serially or on several threads. Any one toy can then be regenerated with RunToyIndex(k).
+  // Use a different seed for each configuration (e.g. RooUnfoldParallel::Seed(master,config,index)).
+  // 0 (the default) takes the toys from RandomGenerator() (see SetToyThreads).
+  _toyseed= seed;
+}
+
+inline
+UInt_t RooUnfold::ToySeed() const
+{
+  // Master seed for per-toy random streams (0 = from RandomGenerator()).
+  return _toyseed;
+}
+
+inline
+Bool_t RooUnfold::IsLinear() const
+{
+  // Is the unfolded distribution a linear function of the measured distribution
+  // (for fixed response matrix and regularisation)? If so, EffectiveMatrix() gives the
+  // unfolding matrix and the kCovToy toys are done with matrix products.
+  return kFALSE;
+}
+
 inline
 Int_t RooUnfold::SystematicsIncluded() const
 {
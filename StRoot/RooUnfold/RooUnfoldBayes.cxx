@@ -18,6 +18,12 @@
 <p>Is able to account for bin migration and smearing
 <p>Can unfold if test and measured distributions have different binning.
 <p>Returns covariance matrices with conditions approximately that of the machine precision. This occasionally leads to very large chi squared values
+<p>With SetSnapshots(), the unfolded distribution, its covariance matrix and the chi squared of change are kept after every iteration,
+so the results for all numbers of iterations up to the regularisation parameter are available from a single unfolding
+(see RecoIter(), CovIter(), Chi2Iter() and HrecoIter()).
+<p>With RooUnfoldResponse::UseSparse(), the iterations only use the non-zero elements of the response, taken from its
+MresponseSparse(), and the dense (effects x causes) response matrices are not made. The unfolding matrix and the error
+propagation matrices are still kept dense.
 END_HTML */
 
 /////////////////////////////////////////////////////////////
@@ -31,10 +37,12 @@ END_HTML */
 #include <iostream>
 #include <iomanip>
 #include <math.h>
+#include <vector>
 
 #include "TNamed.h"
 #include "TH1.h"
 #include "TH2.h"
+#include "TMatrixDSparse.h"
 
 #include "RooUnfoldResponse.h"
 
@@ -45,9 +53,88 @@ using std::cout;
 using std::setw;
 using std::left;
 using std::right;
+using std::vector;
 
 ClassImp (RooUnfoldBayes);
 
+namespace {
+
+  struct ResIter {            // one iteration's quantities needed for the response error propagation
+    TVectorD p, nbar, ujinv;  // prior, unfolded distribution and 1/Uj of the iteration
+    Double_t n0, ntrue;       // normalisations of the prior and of the unfolded distribution
+  };
+
+  struct Pattern {         // row-compressed pattern of the non-zero elements of a matrix
+    vector<Int_t>    row;  // start of each row in col and val (nrows+1 entries)
+    vector<Int_t>    col;
+    vector<Double_t> val;
+  };
+
+  void MakePatterns (const TMatrixDSparse& m, const TVectorD& nCi, const TVectorD& fakes,
+                     TVectorD& eff, Pattern& pe, Pattern& peff)
+  {
+    // Fill pe (by effect) with the non-zero elements of the normalised response m (effect,cause),
+    // plus a fakes cause if nCi has one more entry than m has columns, eff with the efficiency of
+    // each cause, and peff (by cause) with the elements of pe divided by the efficiencies.
+    Int_t ne= m.GetNrows(), nc= nCi.GetNrows(), nt= m.GetNcols();
+    const Int_t*    mrow= m.GetRowIndexArray();
+    const Int_t*    mcol= m.GetColIndexArray();
+    const Double_t* mval= m.GetMatrixArray();
+    Double_t nfinv= (nc > nt && nCi[nc-1] > 0.0) ? 1.0/nCi[nc-1] : 0.0;
+    pe.row.assign (1, 0);
+    pe.col.clear();
+    pe.val.clear();
+    eff.Zero();
+    for (Int_t j = 0 ; j < ne ; j++) {
+      for (Int_t p = mrow[j] ; p < mrow[j+1] ; p++) {
+        Int_t i= mcol[p];
+        if (mval[p] == 0.0 || nCi[i] <= 0.0) continue;
+        pe.col.push_back (i);
+        pe.val.push_back (mval[p]);
+        eff[i] += mval[p];
+      }
+      if (nfinv != 0.0 && fakes[j] != 0.0) {
+        pe.col.push_back (nc-1);
+        pe.val.push_back (fakes[j]*nfinv);
+        eff[nc-1] += fakes[j]*nfinv;
+      }
+      pe.row.push_back (pe.col.size());
+    }
+
+    // transpose into peff, counting the elements of each cause first
+    Int_t nnz= pe.col.size();
+    peff.row.assign (nc+1, 0);
+    for (Int_t p = 0 ; p < nnz ; p++) peff.row[pe.col[p]+1]++;
+    for (Int_t i = 0 ; i < nc ; i++) peff.row[i+1] += peff.row[i];
+    peff.col.resize (nnz);
+    peff.val.resize (nnz);
+    vector<Int_t> next (peff.row.begin(), peff.row.end()-1);
+    for (Int_t j = 0 ; j < ne ; j++) {
+      for (Int_t p = pe.row[j] ; p < pe.row[j+1] ; p++) {
+        Int_t i= pe.col[p], q= next[i]++;
+        peff.col[q]= j;
+        peff.val[q]= eff[i] > 0.0 ? pe.val[p]/eff[i] : 0.0;   // reset PEjCiEff if eff=0
+      }
+    }
+  }
+
+  void MultPattern (const Pattern& pat, const vector<Double_t>& val, const TMatrixD& d, TMatrixD& r)
+  {
+    // r = m * d, where m has the non-zero elements of pat with the values val
+    Int_t nr= pat.row.size()-1, nc= d.GetNcols();
+    r.Zero();
+    for (Int_t i = 0 ; i < nr ; i++) {
+      Double_t* ri= r.GetMatrixArray() + i*nc;
+      for (Int_t p = pat.row[i] ; p < pat.row[i+1] ; p++) {
+        const Double_t* dl= d.GetMatrixArray() + pat.col[p]*nc;
+        Double_t a= val[p];
+        for (Int_t k = 0 ; k < nc ; k++) ri[k] += a*dl[k];
+      }
+    }
+  }
+
+}
+
 RooUnfoldBayes::RooUnfoldBayes (const RooUnfoldBayes& rhs)
   : RooUnfold (rhs)
 {
@@ -75,6 +162,7 @@ RooUnfoldBayes* RooUnfoldBayes::Clone (const char* newname) const
 
 void RooUnfoldBayes::Init()
 {
+  _snapshots= false;
   _nc= _ne= 0;
   _nbartrue= _N0C= 0.0;
   GetSettings();
@@ -82,7 +170,9 @@ void RooUnfoldBayes::Init()
 
 void RooUnfoldBayes::Reset()
 {
+  Bool_t snapshots= _snapshots;  // a setting, like _niter
   Init();
+  _snapshots= snapshots;
   RooUnfold::Reset();
 }
 
@@ -94,8 +184,9 @@ void RooUnfoldBayes::Assign (const RooUnfoldBayes& rhs)
 
 void RooUnfoldBayes::CopyData (const RooUnfoldBayes& rhs)
 {
-  _niter=    rhs._niter;
-  _smoothit= rhs._smoothit;
+  _niter=     rhs._niter;
+  _smoothit=  rhs._smoothit;
+  _snapshots= rhs._snapshots;
 }
 
 void RooUnfoldBayes::Unfold()
@@ -103,7 +194,7 @@ void RooUnfoldBayes::Unfold()
   setup();
   if (verbose() >= 2) {
     Print();
-    RooUnfoldResponse::PrintMatrix(_Nji,"RooUnfoldBayes response matrix (Nji)");
+    if (!_res->UseSparseStatus()) RooUnfoldResponse::PrintMatrix(_Nji,"RooUnfoldBayes response matrix (Nji)");
   }
   if (verbose() >= 1) cout << "Now unfolding..." << endl;
   unfold();
@@ -122,6 +213,41 @@ void RooUnfoldBayes::GetCov()
   _haveCov= true;
 }
 
+Bool_t RooUnfoldBayes::UnfoldRegParms (Int_t n, const Double_t* parms, RooUnfold** unfolds, ErrorTreatment withError) const
+{
+  // Unfolded clones for n numbers of iterations parms[0..n-1], all taken from a single unfolding
+  // with the largest number of iterations, keeping the results of every iteration (see SetSnapshots).
+  // Not for kCovToy errors, which need toys for each number of iterations.
+  if (withError!=kNoError && withError!=kErrors && withError!=kCovariance) return kFALSE;
+  Int_t nmax= 0;
+  for (Int_t i= 0; i<n; i++) {
+    Int_t niter= Int_t(parms[i]+0.5);
+    if (niter<1) return kFALSE;
+    if (niter>nmax) nmax= niter;
+  }
+  RooUnfoldBayes* all= Clone (GetName());
+  all->SetIterations (nmax);
+  all->SetSnapshots();
+  all->Vreco();
+  if (!all->_unfolded) {
+    delete all;
+    return kFALSE;
+  }
+  for (Int_t i= 0; i<n; i++) {
+    Int_t niter= Int_t(parms[i]+0.5);
+    RooUnfoldBayes* unfold= Clone (GetName());
+    unfold->SetIterations (niter);
+    unfold->_rec.ResizeTo (_nt);
+    unfold->_rec= all->RecoIter (niter);
+    unfold->_cov.ResizeTo (_nt, _nt);
+    unfold->_cov= all->CovIter (niter);
+    unfold->_unfolded= unfold->_haveCov= true;
+    unfolds[i]= unfold;
+  }
+  delete all;
+  return kTRUE;
+}
+
 void RooUnfoldBayes::GetSettings()
 {
     _minparm=1;
@@ -154,8 +280,21 @@ void RooUnfoldBayes::setup()
   _nCi.ResizeTo(_nt);
   _nCi= _res->Vtruth();
 
-  _Nji.ResizeTo(_ne,_nt);
-  H2M (_res->Hresponse(), _Nji, _overflow);   // don't normalise, which is what _res->Mresponse() would give us
+  if (_res->UseSparseStatus()) {
+    // unfold() takes the non-zero elements from _res->MresponseSparse() instead
+    _Nji.ResizeTo(0,0);
+  } else if (_res->IsToy()) {
+    // A toy response only holds its smeared Mresponse(), so unnormalise that rather than
+    // have the toy make its response histogram (empty truth bins aren't used).
+    _Nji.ResizeTo(_ne,_nt);
+    const TMatrixD& m= _res->Mresponse();
+    for (Int_t j= 0; j < _nt; j++)
+      for (Int_t i= 0; i < _nm; i++)
+        _Nji(i,j)= m(i,j) * _nCi[j];
+  } else {
+    _Nji.ResizeTo(_ne,_nt);
+    H2M (_res->Hresponse(), _Nji, _overflow);   // don't normalise, which is what _res->Mresponse() would give us
+  }
 
   if (_res->FakeEntries()) {
     TVectorD fakes= _res->Vfakes();
@@ -164,8 +303,10 @@ void RooUnfoldBayes::setup()
     _nc++;
     _nCi.ResizeTo(_nc);
     _nCi[_nc-1]= nfakes;
-    _Nji.ResizeTo(_ne,_nc);
-    for (Int_t i= 0; i<_nm; i++) _Nji(i,_nc-1)= fakes[i];
+    if (!_res->UseSparseStatus()) {
+      _Nji.ResizeTo(_ne,_nc);
+      for (Int_t i= 0; i<_nm; i++) _Nji(i,_nc-1)= fakes[i];
+    }
   }
 
   _nbarCi.ResizeTo(_nc);
@@ -176,7 +317,15 @@ void RooUnfoldBayes::setup()
 #ifndef OLDERRS
   if (_dosys!=2) _dnCidnEj.ResizeTo(_nc,_ne);
 #endif
-  if (_dosys)    _dnCidPjk.ResizeTo(_nc,_ne*_nc);
+  if (_dosys) {
+    _covres.ResizeTo(_nc,_nc);
+    _covres.Zero();
+  }
+
+  Int_t nsnap= _snapshots ? _niter : 0;
+  _recIter.ResizeTo(nsnap,_nt);
+  _covIter.ResizeTo(nsnap*_nt,_nt);
+  _chi2Iter.ResizeTo(nsnap);
 
   // Initial distribution
   _N0C= _nCi.Sum();
@@ -193,22 +342,69 @@ void RooUnfoldBayes::unfold()
   // _niter = number of iterations to perform (3 by default).
   // _smoothit = smooth the matrix in between iterations (default false).
 
-  TMatrixD PEjCi(_ne,_nc), PEjCiEff(_ne,_nc);
-  for (Int_t i = 0 ; i < _nc ; i++) {
-    if (_nCi[i] <= 0.0) { _efficiencyCi[i] = 0.0; continue; }
-    Double_t eff = 0.0;
-    for (Int_t j = 0 ; j < _ne ; j++) {
-      Double_t response = _Nji(j,i) / _nCi[i];
-      PEjCi(j,i) = PEjCiEff(j,i) = response;  // efficiency of detecting the cause Ci in Effect Ej
-      eff += response;
+  // PEjCi is stored as (effect,cause) and the normalised PEjCiEff transposed, as (cause,effect),
+  // so that the loops over effects for Uj and over causes for Mij both run along rows.
+  // With a sparse response, the kernels only loop over the non-zero elements of PEjCi
+  // (by effect, for Uj) and PEjCiEff (by cause, for Mij, and for products with _Mij), which are
+  // taken from the response's MresponseSparse() without making the dense matrices.
+  Bool_t sparse= _res->UseSparseStatus();
+  TMatrixD PEjCi, PEffCiEj;
+  Pattern pe, peff;
+  vector<Double_t> mval;
+  if (sparse) {
+    TVectorD fakes;
+    if (_nc > _nt) {
+      fakes.ResizeTo(_ne);
+      fakes= _res->Vfakes();
+    }
+    MakePatterns (_res->MresponseSparse(), _nCi, fakes, _efficiencyCi, pe, peff);
+    mval.resize (peff.val.size());
+    _Mij.Zero();
+    if (verbose()>=1) cout << "Sparse response: " << peff.val.size() << " of " << _nc*_ne << " elements non-zero" << endl;
+  } else {
+    PEjCi.ResizeTo(_ne,_nc);
+    PEffCiEj.ResizeTo(_nc,_ne);
+    for (Int_t i = 0 ; i < _nc ; i++) {
+      if (_nCi[i] <= 0.0) { _efficiencyCi[i] = 0.0; continue; }
+      Double_t nCinv = 1.0/_nCi[i];
+      Double_t eff = 0.0;
+      Double_t* peff = PEffCiEj.GetMatrixArray() + i*_ne;
+      for (Int_t j = 0 ; j < _ne ; j++) {
+        Double_t response = _Nji(j,i) * nCinv;
+        PEjCi(j,i) = peff[j] = response;  // efficiency of detecting the cause Ci in Effect Ej
+        eff += response;
+      }
+      _efficiencyCi[i] = eff;
+      Double_t effinv = eff > 0.0 ? 1.0/eff : 0.0;   // reset PEjCiEff if eff=0
+      for (Int_t j = 0 ; j < _ne ; j++) peff[j] *= effinv;
     }
-    _efficiencyCi[i] = eff;
-    Double_t effinv = eff > 0.0 ? 1.0/eff : 0.0;   // reset PEjCiEff if eff=0
-    for (Int_t j = 0 ; j < _ne ; j++) PEjCiEff(j,i) *= effinv;
   }
 
   TVectorD PbarCi(_nc);
 
+  // Workspace for the error propagation, allocated once for all iterations
+#if !defined(OLDERRS) && !defined(OLDMULT)
+  TVectorD en(_nc), nr(_nc);
+  TMatrixD M1, M2, M3;
+  if (_dosys!=2) {
+    M1.ResizeTo(_nc,_ne);
+    M2.ResizeTo(_ne,_nc);
+    M3.ResizeTo(_ne,_ne);
+  }
+#endif
+
+  // Variances of the response matrix elements (_ne x _nc) and the iterations' quantities for the response error propagation
+  TMatrixD Vres;
+  vector<ResIter> resIters;
+  if (_dosys) {
+    resIters.resize(_niter);
+    const TMatrixD& Eres= _res->Eresponse();
+    Vres.ResizeTo(_ne,_nc);
+    for (Int_t j = 0 ; j < _ne ; j++)
+      for (Int_t i = 0 ; i < _nc && i < Eres.GetNcols() ; i++)
+        Vres(j,i)= Eres(j,i)*Eres(j,i);
+  }
+
   for (Int_t kiter = 0 ; kiter < _niter; kiter++) {
 
     if (verbose()>=1) cout << "Iteration : " << kiter << endl;
@@ -219,21 +415,42 @@ void RooUnfoldBayes::unfold()
       _N0C = _nbartrue;
     }
 
+    const Double_t* p0    = _P0C.GetMatrixArray();
+    const Double_t* nEst  = _nEstj.GetMatrixArray();
+    Double_t*       ujinv = _UjInv.GetMatrixArray();
     for (Int_t j = 0 ; j < _ne ; j++) {
       Double_t Uj = 0.0;
-      for (Int_t i = 0 ; i < _nc ; i++)
-        Uj += PEjCi(j,i) * _P0C[i];
-      _UjInv[j] = Uj > 0.0 ? 1.0/Uj : 0.0;
+      if (sparse) {
+        for (Int_t p = pe.row[j] ; p < pe.row[j+1] ; p++)
+          Uj += pe.val[p] * p0[pe.col[p]];
+      } else {
+        const Double_t* pej = PEjCi.GetMatrixArray() + j*_nc;
+        for (Int_t i = 0 ; i < _nc ; i++)
+          Uj += pej[i] * p0[i];
+      }
+      ujinv[j] = Uj > 0.0 ? 1.0/Uj : 0.0;
     }
 
     // Unfolding matrix M
     _nbartrue = 0.0;
     for (Int_t i = 0 ; i < _nc ; i++) {
+      Double_t* mi   = _Mij.GetMatrixArray() + i*_ne;
+      Double_t p0i = p0[i];
       Double_t nbarC = 0.0;
-      for (Int_t j = 0 ; j < _ne ; j++) {
-        Double_t Mij = _UjInv[j] * PEjCiEff(j,i) * _P0C[i];
-        _Mij(i,j) = Mij;
-        nbarC += Mij * _nEstj[j];
+      if (sparse) {
+        for (Int_t p = peff.row[i] ; p < peff.row[i+1] ; p++) {
+          Int_t j = peff.col[p];
+          Double_t Mij = ujinv[j] * peff.val[p] * p0i;
+          mi[j] = mval[p] = Mij;
+          nbarC += Mij * nEst[j];
+        }
+      } else {
+        const Double_t* peffi = PEffCiEj.GetMatrixArray() + i*_ne;
+        for (Int_t j = 0 ; j < _ne ; j++) {
+          Double_t Mij = ujinv[j] * peffi[j] * p0i;
+          mi[j] = Mij;
+          nbarC += Mij * nEst[j];
+        }
       }
       _nbarCi[i] = nbarC;
       _nbartrue += nbarC;  // best estimate of true number of events
@@ -249,20 +466,45 @@ void RooUnfoldBayes::unfold()
         _dnCidnEj= _Mij;
       } else {
 #ifndef OLDMULT
-        TVectorD en(_nc), nr(_nc);
+        en.Zero();
+        nr.Zero();
         for (Int_t i = 0 ; i < _nc ; i++) {
           if (_P0C[i]<=0.0) continue;
           Double_t ni= 1.0/(_N0C*_P0C[i]);
           en[i]= -ni*_efficiencyCi[i];
           nr[i]=  ni*_nbarCi[i];
         }
-        TMatrixD M1= _dnCidnEj;
+        M1= _dnCidnEj;
         M1.NormByColumn(nr,"M");
-        TMatrixD M2 (TMatrixD::kTransposed, _Mij);
-        M2.NormByColumn(_nEstj,"M");
-        M2.NormByRow(en,"M");
-        TMatrixD M3 (M2, TMatrixD::kMult, _dnCidnEj);
-        _dnCidnEj.Mult (_Mij, M3);
+        if (sparse) {
+          // As below, but only the non-zero elements of _Mij (and so of M2) contribute
+          M3.Zero();
+          for (Int_t i = 0 ; i < _nc ; i++) {
+            if (en[i]==0.0) continue;
+            const Double_t* dni= _dnCidnEj.GetMatrixArray() + i*_ne;
+            for (Int_t p = peff.row[i] ; p < peff.row[i+1] ; p++) {
+              Int_t j = peff.col[p];
+              Double_t a= mval[p]*nEst[j]*en[i];
+              Double_t* m3j= M3.GetMatrixArray() + j*_ne;
+              for (Int_t k = 0 ; k < _ne ; k++) m3j[k] += a*dni[k];
+            }
+          }
+          _dnCidnEj.Zero();
+          for (Int_t i = 0 ; i < _nc ; i++) {
+            Double_t* dni= _dnCidnEj.GetMatrixArray() + i*_ne;
+            for (Int_t p = peff.row[i] ; p < peff.row[i+1] ; p++) {
+              const Double_t* m3j= M3.GetMatrixArray() + peff.col[p]*_ne;
+              Double_t a= mval[p];
+              for (Int_t k = 0 ; k < _ne ; k++) dni[k] += a*m3j[k];
+            }
+          }
+        } else {
+          M2.Transpose(_Mij);
+          M2.NormByColumn(_nEstj,"M");
+          M2.NormByRow(en,"M");
+          M3.Mult (M2, _dnCidnEj);
+          _dnCidnEj.Mult (_Mij, M3);
+        }
         _dnCidnEj += _Mij;
         _dnCidnEj += M1;
 #else /* OLDMULT */
@@ -290,38 +532,16 @@ void RooUnfoldBayes::unfold()
 #endif
 
     if (_dosys) {
-#ifndef OLDERRS2
-      if (kiter > 0) {
-        TVectorD mbyu(_ne);
-        for (Int_t j = 0 ; j < _ne ; j++) {
-          mbyu[j]= _UjInv[j]*_nEstj[j]/_N0C;
-        }
-        TMatrixD A= _Mij;
-        A.NormByRow (mbyu, "M");
-        TMatrixD B(A, TMatrixD::kMult, PEjCi);
-        TMatrixD dnCidPjkUpd (B, TMatrixD::kMult, _dnCidPjk);
-        Int_t nec= _ne*_nc;
-        for (Int_t i = 0 ; i < _nc ; i++) {
-          if (_P0C[i]<=0.0) continue;  // skip loop: dnCidPjkUpd(i,jk) will also be 0 because _Mij(i,j) will be 0
-          Double_t r= PbarCi[i]/_P0C[i];
-          for (Int_t jk= 0; jk<nec; jk++)
-            _dnCidPjk(i,jk)= r*_dnCidPjk(i,jk) - dnCidPjkUpd(i,jk);
-        }
-      }
-#else  /* OLDERRS2 */
-      if (kiter == _niter-1)   // used to only calculate _dnCidPjk for the final iteration
-#endif
-      for (Int_t j = 0 ; j < _ne ; j++) {
-        if (_UjInv[j]==0.0) continue;
-        Double_t mbyu= _UjInv[j]*_nEstj[j];
-        Int_t j0= j*_nc;
-        for (Int_t i = 0 ; i < _nc ; i++) {
-          Double_t b= -mbyu * _Mij(i,j);
-          for (Int_t k = 0 ; k < _nc ; k++) _dnCidPjk(i,j0+k) += b*_P0C[k];
-          if (_efficiencyCi[i]!=0.0)
-            _dnCidPjk(i,j0+i) += (_P0C[i]*mbyu - _nbarCi[i]) / _efficiencyCi[i];
-        }
-      }
+      // Keep what the response error propagation needs from this iteration (done after the iterations)
+      ResIter& it= resIters[kiter];
+      it.p.ResizeTo(_nc);
+      it.nbar.ResizeTo(_nc);
+      it.ujinv.ResizeTo(_ne);
+      it.p= _P0C;
+      it.nbar= _nbarCi;
+      it.ujinv= _UjInv;
+      it.n0= _N0C;
+      it.ntrue= _nbartrue;
     }
 
     // no need to smooth the last iteraction
@@ -330,55 +550,196 @@ void RooUnfoldBayes::unfold()
     // Chi2 based on Poisson errors
     Double_t chi2 = getChi2(PbarCi, _P0C, _nbartrue);
     if (verbose()>=1) cout << "Chi^2 of change " << chi2 << endl;
+    if (_snapshots) snapshot (kiter, chi2);
 
     // and repeat
   }
+
+  if (!_dosys) return;
+
+  // Response error propagation, one cause (column k of the response) at a time. The derivatives
+  // D= dnCi/dPjk (_nc x _ne) for cause k are updated as D = T*D + G in each iteration, where
+  // G(i,j) = b(i,j)*p[k] + delta_ik*c(k,j) and T is the iteration's update matrix. D*Var(P_jk)*D^T is
+  // then added to the covariance, so only one cause's derivatives are kept at a time.
+  TMatrixD D(_nc,_ne), W(_ne,_ne), TD(_nc,_ne), A, DVD(_nc,_nc);
+  TVectorD v(_ne), r(_nc), mbyu(_ne);
+  vector<Double_t> aval;
+  if (sparse) aval.resize (peff.val.size());
+  else        A.ResizeTo  (_nc,_ne);
+#ifndef OLDERRS2
+  Int_t first= 0;
+#else
+  Int_t first= _niter-1;   // used to only calculate the response errors for the final iteration
+#endif
+  const Double_t* nEst= _nEstj.GetMatrixArray();
+  for (Int_t k = 0 ; k < _nc ; k++) {
+    for (Int_t j = 0 ; j < _ne ; j++) v[j]= Vres(j,k);
+    D.Zero();
+    for (Int_t kiter = first ; kiter < _niter ; kiter++) {
+      const ResIter& it= resIters[kiter];
+      const Double_t* p0=    it.p.GetMatrixArray();
+      const Double_t* ujinv= it.ujinv.GetMatrixArray();
+      for (Int_t j = 0 ; j < _ne ; j++) mbyu[j]= ujinv[j]*nEst[j];
+
+      if (kiter > first) {
+        // D = T*D, where T = diag(PbarCi/P0C) - A*PEjCi with A(i,j) = _Mij(i,j)*mbyu[j]/N0C
+        // (rows with P0C[i]<=0 are left unchanged)
+        for (Int_t i = 0 ; i < _nc ; i++)
+          r[i]= p0[i]>0.0 ? it.nbar[i]/(it.ntrue*p0[i]) : 1.0;
+        if (sparse) {
+          MultPattern (pe, pe.val, D, W);
+          for (Int_t i = 0 ; i < _nc ; i++)
+            for (Int_t p = peff.row[i] ; p < peff.row[i+1] ; p++) {
+              Int_t j = peff.col[p];
+              aval[p]= p0[i]>0.0 ? -ujinv[j]*peff.val[p]*p0[i]*mbyu[j]/it.n0 : 0.0;
+            }
+          MultPattern (peff, aval, W, TD);
+        } else {
+          W.Mult (PEjCi, D);
+          for (Int_t i = 0 ; i < _nc ; i++) {
+            const Double_t* peffi= PEffCiEj.GetMatrixArray() + i*_ne;
+            Double_t*       ai=    A.GetMatrixArray() + i*_ne;
+            for (Int_t j = 0 ; j < _ne ; j++)
+              ai[j]= p0[i]>0.0 ? -ujinv[j]*peffi[j]*p0[i]*mbyu[j]/it.n0 : 0.0;
+          }
+          TD.Mult (A, W);
+        }
+        D.NormByColumn (r, "M");
+        D += TD;
+      }
+
+      // D += G, with b(i,j) = -mbyu[j]*_Mij(i,j) and c(i,j) = (P0C[i]*mbyu[j] - nbarCi[i]) / efficiencyCi[i]
+      for (Int_t i = 0 ; i < _nc ; i++) {
+        Double_t* di= D.GetMatrixArray() + i*_ne;
+        Double_t pik= p0[i]*p0[k];
+        if (sparse) {
+          for (Int_t p = peff.row[i] ; p < peff.row[i+1] ; p++) {
+            Int_t j = peff.col[p];
+            di[j] -= mbyu[j]*ujinv[j]*peff.val[p]*pik;
+          }
+        } else {
+          const Double_t* peffi= PEffCiEj.GetMatrixArray() + i*_ne;
+          for (Int_t j = 0 ; j < _ne ; j++) di[j] -= mbyu[j]*ujinv[j]*peffi[j]*pik;
+        }
+      }
+      if (_efficiencyCi[k]!=0.0) {
+        Double_t* dk= D.GetMatrixArray() + k*_ne;
+        for (Int_t j = 0 ; j < _ne ; j++)
+          if (ujinv[j]!=0.0) dk[j] += (p0[k]*mbyu[j] - it.nbar[k]) / _efficiencyCi[k];
+      }
+
+      if (_snapshots) {
+        // the response errors of cause k after this iteration, for the kept covariance
+        ABAT (D, v, DVD);
+        for (Int_t i = 0 ; i < _nt ; i++)
+          for (Int_t l = 0 ; l < _nt ; l++) _covIter(kiter*_nt+i,l) += DVD(i,l);
+      }
+    }
+    ABAT (D, v, DVD);
+    _covres += DVD;
+  }
 }
 
 //-------------------------------------------------------------------------
 void RooUnfoldBayes::getCovariance()
 {
-  if (_dosys!=2) {
-    if (verbose()>=1) cout << "Calculating covariances due to number of measured events" << endl;
+  if (_dosys!=2 && verbose()>=1) cout << "Calculating covariances due to number of measured events" << endl;
+  if (_dosys    && verbose()>=1) cout << "Calculating covariance due to unfolding matrix..." << endl;
+  _cov.ResizeTo (_nc, _nc);
+  propagateCovariance (_cov);
+}
 
+//-------------------------------------------------------------------------
+void RooUnfoldBayes::propagateCovariance(TMatrixD& cov) const
+{
+  // Fill cov (_nc x _nc) from the error propagation matrices of the current iteration
+  if (_dosys!=2) {
     // Create the covariance matrix of result from that of the measured distribution
-    _cov.ResizeTo (_nc, _nc);
 #ifdef OLDERRS
     const TMatrixD& Dprop= _Mij;
 #else
     const TMatrixD& Dprop= _dnCidnEj;
 #endif
     if (_haveCovMes) {
-      ABAT (Dprop, GetMeasuredCov(), _cov);
+      ABAT (Dprop, GetMeasuredCov(), cov);
     } else {
       TVectorD v= Emeasured();
       v.Sqr();
-      ABAT (Dprop, v, _cov);
+      ABAT (Dprop, v, cov);
     }
   }
 
   if (_dosys) {
-    if (verbose()>=1) cout << "Calculating covariance due to unfolding matrix..." << endl;
+    // Covariance due to the response matrix statistics (accumulated in unfold())
+    if (_dosys!=2) cov += _covres;
+    else           cov=  _covres;
+  }
+}
 
-    const TMatrixD& Eres= _res->Eresponse();
-    TVectorD Vjk(_ne*_nc);           // vec(Var(j,k))
-    for (Int_t j = 0 ; j < _ne ; j++) {
-      Int_t j0= j*_nc;
-      for (Int_t i = 0 ; i < _nc ; i++) {
-        Double_t e= Eres(j,i);
-        Vjk[j0+i]= e*e;
-      }
-    }
+//-------------------------------------------------------------------------
+void RooUnfoldBayes::snapshot(Int_t kiter, Double_t chi2)
+{
+  // Keep the results after iteration kiter (0 = first), dropping the fakes bin.
+  // These are the same as the final results of an unfolding with kiter+1 iterations.
+  for (Int_t i = 0 ; i < _nt ; i++) _recIter(kiter,i)= _nbarCi[i];
+  TMatrixD cov(_nc,_nc);
+  propagateCovariance (cov);
+  cov.ResizeTo (_nt, _nt);
+  _covIter.SetSub (kiter*_nt, 0, cov);
+  _chi2Iter[kiter]= chi2;
+}
 
-    if (_dosys!=2) {
-      TMatrixD covres(_nc,_nc);
-      ABAT (_dnCidPjk, Vjk, covres);
-      _cov += covres;
-    } else {
-      _cov.ResizeTo (_nc, _nc);
-      ABAT (_dnCidPjk, Vjk, _cov);
-    }
+//-------------------------------------------------------------------------
+Bool_t RooUnfoldBayes::haveSnapshot(Int_t niter)
+{
+  // Unfold if necessary and check that the results after niter iterations were kept.
+  if (!_unfolded) Vreco();
+  if (_unfolded && niter >= 1 && niter <= _chi2Iter.GetNrows()) return true;
+  cerr << "RooUnfoldBayes: no results kept after " << niter << " iterations";
+  if (!_snapshots) cerr << " (SetSnapshots() not set before unfolding)";
+  cerr << endl;
+  return false;
+}
+
+TVectorD RooUnfoldBayes::RecoIter (Int_t niter)
+{
+  // Unfolded distribution after niter (1.._niter) iterations.
+  TVectorD rec(_nt);
+  if (!haveSnapshot (niter)) return rec;
+  for (Int_t i = 0 ; i < _nt ; i++) rec[i]= _recIter(niter-1,i);
+  return rec;
+}
+
+TMatrixD RooUnfoldBayes::CovIter (Int_t niter)
+{
+  // Covariance matrix of the unfolded distribution after niter (1.._niter) iterations.
+  if (!haveSnapshot (niter)) return TMatrixD(_nt,_nt);
+  return _covIter.GetSub ((niter-1)*_nt, niter*_nt-1, 0, _nt-1);
+}
+
+Double_t RooUnfoldBayes::Chi2Iter (Int_t niter)
+{
+  // Chi^2 of the change in iteration niter (1.._niter).
+  if (!haveSnapshot (niter)) return -1.0;
+  return _chi2Iter[niter-1];
+}
+
+TH1* RooUnfoldBayes::HrecoIter (Int_t niter)
+{
+  // Unfolded histogram after niter (1.._niter) iterations, with errors from the
+  // square root of the diagonals of CovIter(niter).
+  TH1* reco= (TH1*) _res->Htruth()->Clone(GetName());
+  reco->Reset();
+  reco->SetTitle (GetTitle());
+  if (!haveSnapshot (niter)) return reco;
+
+  Int_t i0= (niter-1)*_nt;
+  for (Int_t i= 0; i < _nt; i++) {
+    Int_t j= RooUnfoldResponse::GetBin (reco, i, _overflow);
+    reco->SetBinContent (j, _recIter(niter-1,i));
+    reco->SetBinError   (j, sqrt (fabs (_covIter(i0+i,i))));
   }
+  return reco;
 }
 
 //-------------------------------------------------------------------------
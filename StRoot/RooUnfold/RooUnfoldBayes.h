@@ -41,12 +41,21 @@ public:
 
   void SetIterations (Int_t niter= 4);
   void SetSmoothing  (Bool_t smoothit= false);
+  void SetSnapshots  (Bool_t snapshots= true);
   Int_t GetIterations() const;
   Int_t GetSmoothing()  const;
+  Bool_t GetSnapshots() const;
   const TMatrixD& UnfoldingMatrix() const;
 
+  // Results after fewer iterations (needs SetSnapshots() before unfolding)
+  TVectorD RecoIter  (Int_t niter);  // unfolded distribution after niter iterations
+  TMatrixD CovIter   (Int_t niter);  // its covariance matrix
+  Double_t Chi2Iter  (Int_t niter);  // chi^2 of change in iteration niter
+  TH1*     HrecoIter (Int_t niter);  // unfolded histogram, with errors from CovIter()
+
   virtual void  SetRegParm (Double_t parm);
   virtual Double_t GetRegParm() const;
+  virtual Bool_t UnfoldRegParms (Int_t n, const Double_t* parms, RooUnfold** unfolds, ErrorTreatment withError) const;
   virtual void Reset();
   virtual void Print (Option_t* option= "") const;
 
@@ -61,6 +70,9 @@ protected:
   void setup();
   void unfold();
   void getCovariance();
+  void propagateCovariance(TMatrixD& cov) const;
+  void snapshot(Int_t kiter, Double_t chi2);
+  Bool_t haveSnapshot(Int_t niter);
 
   void smooth(TVectorD& PbarCi) const;
   Double_t getChi2(const TVectorD& prob1,
@@ -75,6 +87,7 @@ protected:
   // instance variables
   Int_t _niter;
   Int_t _smoothit;
+  Bool_t _snapshots;      // keep results of each iteration
 
   Int_t _nc;              // number of causes  (same as _nt)
   Int_t _ne;              // number of effects (same as _nm)
@@ -93,10 +106,14 @@ protected:
   TMatrixD _Vij;          // covariance matrix
   TMatrixD _VnEstij;      // covariance matrix of effects
   TMatrixD _dnCidnEj;     // measurement error propagation matrix
-  TMatrixD _dnCidPjk;     // response error propagation matrix (stack j,k into each column)
+  TMatrixD _covres;       // covariance due to response matrix statistics (from the response error propagation)
+
+  TMatrixD _recIter;      // unfolded distribution after each iteration (one row per iteration)
+  TMatrixD _covIter;      // covariance matrix after each iteration (stack iterations into rows)
+  TVectorD _chi2Iter;     // chi^2 of change in each iteration
 
 public:
-  ClassDef (RooUnfoldBayes, 1) // Bayesian Unfolding
+  ClassDef (RooUnfoldBayes, 3) // Bayesian Unfolding
 };
 
 // Inline method definitions
@@ -148,6 +165,14 @@ void RooUnfoldBayes::SetSmoothing (Bool_t smoothit)
   _smoothit= smoothit;
 }
 
+inline
+void RooUnfoldBayes::SetSnapshots (Bool_t snapshots)
+{
+  // Keep the unfolded distribution, covariance and chi^2 of change after every iteration,
+  // so the results for all numbers of iterations up to _niter come from one unfolding
+  _snapshots= snapshots;
+}
+
 inline
 Int_t RooUnfoldBayes::GetIterations() const
 {
@@ -162,6 +187,13 @@ Int_t RooUnfoldBayes::GetSmoothing()  const
   return _smoothit;
 }
 
+inline
+Bool_t RooUnfoldBayes::GetSnapshots() const
+{
+  // Return snapshot setting
+  return _snapshots;
+}
+
 inline
 const TMatrixD& RooUnfoldBayes::UnfoldingMatrix() const
 {
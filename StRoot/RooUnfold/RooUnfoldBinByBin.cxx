@@ -92,6 +92,32 @@ RooUnfoldBinByBin::Unfold()
     _unfolded= true;
 }
 
+Bool_t
+RooUnfoldBinByBin::IsLinear() const
+{
+  // The unfolded distribution is the measured distribution times the correction factors
+  return true;
+}
+
+Bool_t
+RooUnfoldBinByBin::EffectiveMatrix (TMatrixD& m)
+{
+  // Unfolding matrix: the correction factors on the diagonal, applied after subtracting the fakes
+  if (_dosys) return false;
+  Vreco();
+  if (!_unfolded) return false;
+  TMatrixD f= FakesMatrix();
+  m.ResizeTo(_nt,_nm);
+  m.Zero();
+  Int_t nb= _nm < _nt ? _nm : _nt;
+  for (Int_t i=0; i<nb; i++) {
+    Double_t c= _factors[i];
+    if (c==0.0) continue;
+    for (Int_t j=0; j<_nm; j++) m(i,j)= c*f(i,j);
+  }
+  return true;
+}
+
 void
 RooUnfoldBinByBin::GetCov()
 {
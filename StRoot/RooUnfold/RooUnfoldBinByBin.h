@@ -32,6 +32,8 @@ public:
   virtual RooUnfoldBinByBin* Clone (const char* newname= 0) const;
   RooUnfoldBinByBin (const RooUnfoldResponse* res, const TH1* meas, const char* name=0, const char* title=0);
 
+  virtual Bool_t IsLinear() const;
+  virtual Bool_t EffectiveMatrix (TMatrixD& m);
   TVectorD* Impl();
 
 protected:
@@ -12,10 +12,14 @@
 
 //____________________________________________________________
 /* BEGIN_HTML
-<p>Unfolding interface to Fortran routine, BAYES, by G. D'Agostini from
+<p>Bayesian unfolding following the Fortran routine, BAYES, by G. D'Agostini from
 http://www.roma1.infn.it/~dagos/bayes_distr.txt .
-The Makefile only compiles this class if bayes.for and bayes_c.for are placed in
-the src directory.
+The algorithm (in the mode used here: no smoothing of the prior between iterations)
+is implemented directly in C++, with the working arrays held by each object and sized to the
+problem, so there is no limit on the number of bins and separate objects can unfold at the same time
+(eg. the toys and regularisation scans run on several threads). It is a cross-check of RooUnfoldBayes.
+<p>As for BAYES, fakes are handled by an extra truth bin, and the error matrix only includes
+the (Poisson) errors on the measured distribution.
 END_HTML */
 
 /////////////////////////////////////////////////////////////
@@ -35,27 +39,6 @@ using std::cout;
 using std::cerr;
 using std::endl;
 
-// SIZE_C and SIZE_E must agree exactly with PARAMETERs in bayes.for.
-#define SIZE_C 100
-#define SIZE_E 100
-
-extern "C" {
-  // bayes_ arguments must agree with the BAYES subroutine in bayes.for.
-  extern void bayes_ (const int* noc, const int* noe, int* nsteps, const int* mode, const int* er_mode, const int* keep, int* ier);
-  // bayesc_ must agree with the /BAYESC/ common block in bayes_c.for.
-  extern struct {
-    float pec[SIZE_C][SIZE_E], pce[SIZE_E][SIZE_C], 
-          pc[SIZE_C], ne[SIZE_E], nc[SIZE_C], 
-          nec_mc[SIZE_C][SIZE_E], nc_mc[SIZE_C], 
-          Vc[SIZE_C][SIZE_C], eff[SIZE_C], eff_0, eff_true,
-          Vc0[SIZE_C][SIZE_C], Vc1[SIZE_C][SIZE_C],
-          M_unf[SIZE_E][SIZE_C], Vc_u[SIZE_C][SIZE_C],
-          Vc0_u[SIZE_C][SIZE_C], Vpc[SIZE_C][SIZE_C],
-          Vpc0[SIZE_C][SIZE_C], Vpc1[SIZE_C][SIZE_C];
-  } bayesc_;
-}
-
-
 ClassImp (RooUnfoldDagostini);
 
 RooUnfoldDagostini::RooUnfoldDagostini (const RooUnfoldDagostini& rhs)
@@ -91,12 +74,19 @@ RooUnfoldDagostini::~RooUnfoldDagostini()
 void
 RooUnfoldDagostini::Init()
 {
+  _ntf= 0;
   GetSettings();
 }
 
 void
 RooUnfoldDagostini::Reset()
 {
+  _pec.clear();
+  _pc.clear();
+  _eff.clear();
+  _ne.clear();
+  _nc.clear();
+  _munf.clear();
   Init();
   RooUnfold::Reset();
 }
@@ -111,54 +101,88 @@ RooUnfoldDagostini::Assign (const RooUnfoldDagostini& rhs)
 void
 RooUnfoldDagostini::Unfold()
 {
-  Int_t nt= _nt, nm= _nm;
-  if (nt > SIZE_C) {
-    cerr << nt << " truth bins is too large - maximum is "  << SIZE_C << endl;
-    nt= SIZE_C;
-  }
-  if (nm > SIZE_E) {
-    cerr << nm << " measured bins is too large - maximum is "  << SIZE_E << endl;
-    nm= SIZE_E;
-  }
+  // Iterative Bayesian unfolding, as BAYES. The arrays are laid out cause by cause
+  // (truth bin i, then measured bin j), so the inner loops run over contiguous elements.
   if (_haveCovMes) cerr << "Warning: BAYES does not account for bin-bin correlations on measured input" << endl;
-  
+
+  Int_t nt= _nt, nm= _nm;
   const TMatrixD& res= _res->Mresponse();
   const TVectorD& tru= _res->Vtruth();
   const TVectorD& meas= Vmeasured();
-  Double_t ntrue= 0;
-  for (Int_t i= 0; i < nt; i++) {
-    bayesc_.pc[i]=    tru(i);
-    bayesc_.nc_mc[i]= tru(i);
-    ntrue +=  tru(i);
-    for (Int_t j= 0; j < nm; j++)
-      bayesc_.nec_mc[i][j]= tru(i) * res(j,i);
-  }
 
-  Int_t ntf= nt;
+  TVectorD fakes;
+  Double_t nfakes= 0.0;
   if (_res->FakeEntries()) {
-    TVectorD fakes= _res->Vfakes();
-    Double_t nfakes= fakes.Sum();
+    fakes.ResizeTo (nm);
+    fakes= _res->Vfakes();
+    nfakes= fakes.Sum();
     if (_verbose>=1) cout << "Add truth bin for " << nfakes << " fakes" << endl;
-    ntf++;
-    ntrue +=              nfakes;
-    bayesc_.pc[ntf-1]=    nfakes;
-    bayesc_.nc_mc[ntf-1]= nfakes;
-    for (Int_t j= 0; j < nm; j++)
-      bayesc_.nec_mc[ntf-1][j]= fakes[j];
   }
+  _ntf= nfakes!=0.0 ? nt+1 : nt;
 
-  for (Int_t i= 0; i < ntf; i++)
-    bayesc_.pc[i] /= ntrue;
+  // Prior and probability of each effect j given cause i (the response, which includes the efficiency)
+  _pec.assign (_ntf*nm, 0.0);
+  _pc.assign  (_ntf,    0.0);
+  _eff.assign (_ntf,    0.0);
+  Double_t ntrue= 0.0;
+  for (Int_t i= 0; i < nt; i++) {
+    _pc[i]= tru(i);
+    ntrue += tru(i);
+    if (tru(i)==0.0) continue;
+    Double_t* pec= &_pec[i*nm];
+    for (Int_t j= 0; j < nm; j++)
+      pec[j]= res(j,i);
+  }
+  if (_ntf > nt) {
+    _pc[nt]= nfakes;
+    ntrue += nfakes;
+    Double_t* pec= &_pec[nt*nm];
+    for (Int_t j= 0; j < nm; j++)
+      pec[j]= fakes[j] / nfakes;
+  }
+  for (Int_t i= 0; i < _ntf; i++) {
+    const Double_t* pec= &_pec[i*nm];
+    for (Int_t j= 0; j < nm; j++)
+      _eff[i] += pec[j];
+    if (ntrue!=0.0) _pc[i] /= ntrue;
+  }
+  _ne.resize (nm);
   for (Int_t j= 0; j < nm; j++)
-    bayesc_.ne[j]= meas(j);
-
-  int mode= 2, er_mode= 20, keep= 0, ier= 0;
-  bayes_ (&ntf, &nm, &_niter, &mode, &er_mode, &keep, &ier);
-  if (ier != 0) cerr << "BAYES returned error " << ier << endl;
+    _ne[j]= meas(j);
+
+  // Iterate: unfolding matrix from the current prior, then the prior from the result
+  _munf.assign (_ntf*nm, 0.0);
+  _nc.assign   (_ntf,    0.0);
+  std::vector<Double_t> norm (nm);
+  Int_t nsteps= _niter > 1 ? _niter : 1;
+  for (Int_t k= 0; k < nsteps; k++) {
+    norm.assign (nm, 0.0);
+    for (Int_t i= 0; i < _ntf; i++) {
+      const Double_t* pec= &_pec[i*nm];
+      Double_t pc= _pc[i];
+      for (Int_t j= 0; j < nm; j++)
+        norm[j] += pec[j] * pc;
+    }
+    Double_t nctot= 0.0;
+    for (Int_t i= 0; i < _ntf; i++) {
+      const Double_t* pec= &_pec[i*nm];
+      Double_t* munf= &_munf[i*nm];
+      Double_t f= _eff[i]!=0.0 ? _pc[i] / _eff[i] : 0.0, nc= 0.0;
+      for (Int_t j= 0; j < nm; j++) {
+        munf[j]= norm[j]!=0.0 ? f * pec[j] / norm[j] : 0.0;
+        nc += munf[j] * _ne[j];
+      }
+      _nc[i]= nc;
+      nctot += nc;
+    }
+    if (nctot!=0.0)
+      for (Int_t i= 0; i < _ntf; i++)
+        _pc[i]= _nc[i] / nctot;
+  }
 
   _rec.ResizeTo (_nt);
   for (Int_t i= 0; i < nt; i++)
-    _rec(i)= bayesc_.nc[i];
+    _rec(i)= _nc[i];
 
   _unfolded= true;
   _haveCov=  false;
@@ -167,11 +191,20 @@ RooUnfoldDagostini::Unfold()
 void
 RooUnfoldDagostini::GetCov()
 {
-  Int_t nt= _nt < SIZE_C ? _nt : SIZE_C;
+  // Error matrix from the errors on the measured distribution: M V(ne) M^T for the final unfolding matrix
+  Int_t nm= _nm;
   _cov.ResizeTo(_nt,_nt);
-  for (Int_t i= 0; i < nt; i++)
-    for (Int_t j= 0; j < nt; j++)
-      _cov(i,j)= bayesc_.Vc0_u[j][i];
+  if (_munf.size() < size_t(_nt*nm)) return;
+  for (Int_t i= 0; i < _nt; i++) {
+    const Double_t* mi= &_munf[i*nm];
+    for (Int_t j= 0; j <= i; j++) {
+      const Double_t* mj= &_munf[j*nm];
+      Double_t v= 0.0;
+      for (Int_t k= 0; k < nm; k++)
+        v += mi[k] * mj[k] * _ne[k];
+      _cov(i,j)= _cov(j,i)= v;
+    }
+  }
   _haveCov= true;
 }
 
@@ -13,6 +13,8 @@
 #ifndef ROOUNFOLDDAGOSTINI_H_
 #define ROOUNFOLDDAGOSTINI_H_
 
+#include <vector>
+
 #include "RooUnfold.h"
 
 class RooUnfoldResponse;
@@ -52,6 +54,15 @@ protected:
   // instance variables
   Int_t _niter;
 
+  // working arrays, [cause*nm+effect] (nm= measured bins)
+  Int_t _ntf;                  //! number of causes (truth bins, plus one for fakes)
+  std::vector<Double_t> _pec;  //! P(effect|cause)
+  std::vector<Double_t> _pc;   //! prior P(cause)
+  std::vector<Double_t> _eff;  //! efficiency of each cause
+  std::vector<Double_t> _ne;   //! measured distribution
+  std::vector<Double_t> _nc;   //! unfolded distribution
+  std::vector<Double_t> _munf; //! unfolding matrix
+
 public:
   ClassDef (RooUnfoldDagostini, 1) // Bayesian Unfolding
 };
@@ -20,7 +20,7 @@ maths needed to plot these graphs. The object requires the number of toys over w
 <ul>
 <li> A graph of the errors from the unfolding (Unf_err())
 <li> A graph of the errors due to the spread of the reconstructed points (Spread())
-<li> An error matrix based on the spread of the reconstructed points (True_err())
+<li> An error matrix based on the spread of the reconstructed points (CovToy())
 </ul>
 <p> If the true distribution is known then a plot of the chi squared values can also be returned (Chi2()).
  This requires the inclusion of the truth distribution and the error method on which the chi squared is based 
@@ -34,7 +34,6 @@ END_HTML */
 
 #include <iostream>
 #include <cmath>
-#include <vector>
 
 #include "TString.h"
 #include "TStyle.h"
@@ -108,6 +107,12 @@ RooUnfoldErrors::RMSResiduals(){
     return dynamic_cast<TH1*>(h_err_res->Clone());
 }
 
+const TMatrixD&
+RooUnfoldErrors::CovToy() const {
+    //Returns the covariance matrix of the toy results//
+    return cov_toy;
+}
+
 TH1* 
 RooUnfoldErrors::UnfoldingError(){
     if (!h_err) return h_err;
@@ -133,10 +138,12 @@ RooUnfoldErrors::CreatePlots()
 
     unfold->SetNToys(toys);
     const TVectorD errunf= unfold->ErecoV(RooUnfold::kErrors);
-    const TVectorD errtoy= unfold->ErecoV(RooUnfold::kCovToy);
+    const TMatrixD covtoy= unfold->Ereco (RooUnfold::kCovToy);  // one set of toys, kept whole
+    cov_toy.ResizeTo (ntx, ntx);
     for (int i= 0; i<ntx; i++) {
       h_err    ->SetBinContent(i+1,errunf[i]);
-      h_err_res->SetBinContent(i+1,errtoy[i]);
+      h_err_res->SetBinContent(i+1,sqrt (fabs (covtoy(i,i))));
+      for (int j= 0; j<ntx; j++) cov_toy(i,j)= covtoy(i,j);
     }
     return;
 }
@@ -146,7 +153,9 @@ void
 RooUnfoldErrors::CreatePlotsWithChi2()
 {
     /*Gets the values for plotting. Uses the Runtoy method from RooUnfold to get plots to analyse for
-    spread and error on the unfolding. Can also give values for a chi squared plot if a truth distribution is known*/
+    spread and error on the unfolding. Can also give values for a chi squared plot if a truth distribution is known.
+    The spread of the toys is accumulated as they are made (running mean and co-moments), so one set of
+    toys gives the errors, the RMS, the chi squared values and the full covariance, without any clipping.*/
 
     const Double_t maxchi2=1e10;
 
@@ -156,25 +165,24 @@ RooUnfoldErrors::CreatePlotsWithChi2()
     h_err     = new TProfile ("unferr", "Unfolding errors", ntx, xlo, xhi); 
     h_err_res = new TH1D     ("toyerr", "Toy MC RMS",       ntx, xlo, xhi); 
     hchi2     = new TNtuple  ("chi2", "chi2", "chi2");
-    std::vector<TH1D*> graph_vector(ntx);
-    for (int a=0; a<ntx; a++) {
-      TString graph_name;
-      graph_name.Form("resbin%d",a);
-      graph_vector[a]= new TH1D (graph_name,graph_name, 100,0,10000);
-    }
     
     TH1::AddDirectory (oldstat);
     
     int odd_ch=0;
+    Int_t    n= 0;
+    TVectorD x    (ntx);
+    TVectorD mean (ntx);
+    TMatrixD comom(ntx,ntx);
     for (int k=0; k<toys;k++){  
-        RooUnfold* toy= unfold->RunToy();
+        RooUnfold* toy= unfold->RunToyIndex(k);
         Double_t chi2=       toy->Chi2 (hTrue);
         const TVectorD reco= toy->Vreco();
         const TVectorD err=  toy->ErecoV();
         for (int i=0; i<ntx; i++) {    
-            graph_vector[i]->Fill(reco[i]);
+            x[i]= reco[i];
             h_err->Fill(h_err->GetBinCenter(i+1),err[i]);
         } 
+        RooUnfold::AddToy (n, mean, comom, x);
         if (hTrue){
             hchi2->Fill(chi2);
             if (fabs(chi2)>=maxchi2 && toy->verbose()>=1){
@@ -184,14 +192,16 @@ RooUnfoldErrors::CreatePlotsWithChi2()
         }
         delete toy;
     }
+    cov_toy.ResizeTo (ntx, ntx);
+    if (n>1) {
+      cov_toy= comom;
+      cov_toy *= 1.0/(n-1);
+    }
     for (int i=0; i<ntx; i++){
-      TH1D* graph= graph_vector[i];
-        Double_t n= graph->GetEntries();
-        if (n<=0.0) continue;
-        Double_t spr= graph->GetRMS();
+        if (n<=0) continue;
+        Double_t spr= sqrt (comom(i,i)/n);
         h_err_res->SetBinContent (i+1, spr);
-        h_err_res->SetBinError   (i+1, spr/sqrt(2*n));
-        delete graph;
+        h_err_res->SetBinError   (i+1, spr/sqrt(2.0*n));
     }
     
     if (odd_ch){
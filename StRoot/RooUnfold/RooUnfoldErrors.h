@@ -13,6 +13,7 @@
 #define ROOUNFOLDERRORS_H_
 
 #include "TNamed.h"
+#include "TMatrixD.h"
 
 class TH1;
 class RooUnfold;
@@ -31,6 +32,7 @@ public:
 
   TH1* RMSResiduals();
   TH1* UnfoldingError();
+  const TMatrixD& CovToy() const;
 
 private:
   void CreatePlots();
@@ -38,6 +40,7 @@ private:
   TH1* h_err; // Output plot
   TH1* h_err_res; // Output plot
   TNtuple* hchi2;  // Output plot 
+  TMatrixD cov_toy; // Covariance of the toy results
   void GraphParameters(); //
   double xlo; // Minimum x-axis value 
   double xhi; // Maximum x-axis value
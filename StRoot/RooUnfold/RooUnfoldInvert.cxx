@@ -142,6 +142,25 @@ RooUnfoldInvert::GetCov()
     _haveCov= true;
 }
 
+Bool_t
+RooUnfoldInvert::IsLinear() const
+{
+  // The unfolded distribution is the inverse response matrix times the measured distribution
+  return true;
+}
+
+Bool_t
+RooUnfoldInvert::EffectiveMatrix (TMatrixD& m)
+{
+  // Unfolding matrix: the inverse response matrix, applied after subtracting the fakes
+  if (_dosys) return false;
+  Vreco();
+  if (!_unfolded || !InvertResponse()) return false;
+  m.ResizeTo(_nt,_nm);
+  m.Mult (*_resinv, FakesMatrix());
+  return true;
+}
+
 Bool_t
 RooUnfoldInvert::InvertResponse()
 {
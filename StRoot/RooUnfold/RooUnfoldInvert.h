@@ -35,6 +35,8 @@ public:
   RooUnfoldInvert (const RooUnfoldResponse* res, const TH1* meas, const char* name=0, const char* title=0);
 
   virtual void Reset();
+  virtual Bool_t IsLinear() const;
+  virtual Bool_t EffectiveMatrix (TMatrixD& m);
   TDecompSVD* Impl();
 
 protected:
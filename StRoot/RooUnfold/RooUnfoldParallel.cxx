@@ -0,0 +1,138 @@
+//=====================================================================-*-C++-*-
+// File and Version Information:
+//      $Id$
+//
+// Description:
+//      Minimal task pool for running independent jobs on several threads.
+//
+//==============================================================================
+
+//____________________________________________________________
+/* BEGIN_HTML
+<p>Runs a job function once for each task index 0..ntasks-1, spreading the tasks over a
+number of TThreads. Tasks are handed out dynamically, so an idle thread always picks up
+the next unstarted task. The caller is responsible for writing each task's results to
+its own slot and reducing them in task order afterwards, which keeps results independent
+of which thread ran which task.</p>
+<p>With one thread (the default) or a single task, the tasks run serially in the calling
+thread and no threads are created.</p>
+<p>Random numbers for the tasks come from counter-based streams: Seed(seed,config,stream)
+gives an independent generator seed for each (master seed, configuration, toy or chunk index),
+so any one stream can be regenerated on its own, independent of the order in which, or the
+thread on which, the streams are used. Key() turns a configuration label into a key.</p>
+END_HTML */
+
+/////////////////////////////////////////////////////////////
+
+#include "RooUnfoldParallel.h"
+
+#include <vector>
+
+#include "TThread.h"
+#include "TMutex.h"
+
+using std::vector;
+
+Int_t RooUnfoldParallel::_nthreads= 1;
+
+namespace {
+
+  struct TaskQueue {
+    RooUnfoldParallel::Task task;
+    void*  arg;
+    Int_t  ntasks;
+    Int_t  next;
+    TMutex lock;
+  };
+
+  void* RunTasks (void* arg)
+  {
+    // Thread body: keep taking the next task index until there are none left.
+    TaskQueue* queue= (TaskQueue*) arg;
+    for (;;) {
+      queue->lock.Lock();
+      Int_t itask= queue->next++;
+      queue->lock.UnLock();
+      if (itask >= queue->ntasks) break;
+      queue->task (itask, queue->arg);
+    }
+    return 0;
+  }
+
+}
+
+Int_t RooUnfoldParallel::Run (Int_t ntasks, Task task, void* arg, Int_t nthreads)
+{
+  // Run task(i,arg) for i= 0..ntasks-1 on nthreads threads (default from SetNThreads).
+  // Returns the number of threads used.
+  if (nthreads < 0)      nthreads= _nthreads;
+  if (nthreads > ntasks) nthreads= ntasks;
+  if (nthreads <= 1) {
+    for (Int_t i= 0; i < ntasks; i++) task (i, arg);
+    return 1;
+  }
+
+  if (!TThread::IsInitialized()) TThread::Initialize();
+
+  TaskQueue queue;
+  queue.task=   task;
+  queue.arg=    arg;
+  queue.ntasks= ntasks;
+  queue.next=   0;
+
+  vector<TThread*> threads (nthreads);
+  for (Int_t i= 0; i < nthreads; i++) {
+    threads[i]= new TThread (RunTasks, &queue);
+    threads[i]->Run();
+  }
+  for (Int_t i= 0; i < nthreads; i++) {
+    threads[i]->Join();
+    delete threads[i];
+  }
+  return nthreads;
+}
+
+void RooUnfoldParallel::SetNThreads (Int_t nthreads)
+{
+  // Set default number of threads used by Run(). 1 (the default) runs everything serially.
+  _nthreads= nthreads > 1 ? nthreads : 1;
+}
+
+Int_t RooUnfoldParallel::GetNThreads()
+{
+  // Default number of threads used by Run().
+  return _nthreads;
+}
+
+UInt_t RooUnfoldParallel::Seed (UInt_t seed, UInt_t stream)
+{
+  // Derive a well-mixed, non-zero random number seed for an independent stream
+  // (e.g. one per task) from a master seed (SplitMix64 finaliser).
+  ULong64_t z= (ULong64_t(seed) << 32) + stream + 1;
+  z *= 0x9E3779B97F4A7C15ULL;
+  z= (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z= (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z=  z ^ (z >> 31);
+  UInt_t s= UInt_t(z ^ (z >> 32));
+  return s ? s : 1;  // TRandom3 treats seed 0 as "seed from the clock"
+}
+
+UInt_t RooUnfoldParallel::Seed (UInt_t seed, UInt_t config, UInt_t stream)
+{
+  // Seed for stream number stream (e.g. a toy index) of configuration config
+  // (e.g. from Key()), derived from a master seed.
+  return Seed (Seed (seed, config), stream);
+}
+
+UInt_t RooUnfoldParallel::Key (const char* label)
+{
+  // Configuration key for Seed() from a label (FNV-1a hash).
+  UInt_t h= 2166136261U;
+  if (label) {
+    for (const char* c= label; *c; c++) {
+      h ^= UChar_t(*c);
+      h *= 16777619U;
+    }
+  }
+  return h;
+}
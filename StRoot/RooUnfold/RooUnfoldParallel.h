@@ -0,0 +1,32 @@
+//=====================================================================-*-C++-*-
+// File and Version Information:
+//      $Id$
+//
+// Description:
+//      Minimal task pool for running independent jobs on several threads.
+//
+//==============================================================================
+
+#ifndef ROOUNFOLDPARALLEL_HH
+#define ROOUNFOLDPARALLEL_HH
+
+#include "Rtypes.h"
+
+class RooUnfoldParallel {
+
+public:
+
+  typedef void (*Task) (Int_t itask, void* arg);  // job function: called once for each task index
+
+  static Int_t  Run (Int_t ntasks, Task task, void* arg, Int_t nthreads= -1);
+  static void   SetNThreads (Int_t nthreads);
+  static Int_t  GetNThreads();
+  static UInt_t Seed (UInt_t seed, UInt_t stream);
+  static UInt_t Seed (UInt_t seed, UInt_t config, UInt_t stream);  // stream of one configuration
+  static UInt_t Key (const char* label);                             // configuration key from a label
+
+private:
+  static Int_t _nthreads;  // default number of threads (1 = run serially)
+};
+
+#endif
@@ -23,6 +23,9 @@
 <p>For each regularisaion parameter in the predefined range, the measured distribution is unfolded. For each unfolded distribution residuals are plotted and rms found for the 
 rms spread. The sum of the residuals over the whole distribution are calculated,divided by the number of bins and then rooted in order to 
 return an rms. The chi squared values are calculated using the chi2() method in RooUnfold.</p>
+<p>The regularisation parameters can be evaluated on several threads (SetThreads()), each with its own clone of the
+unfolding object. For RooUnfoldBayes and RooUnfoldSvd, all the parameters are unfolded together first (using the results
+of every iteration, or one decomposition for all kreg), unless toy errors are requested.</p>
 
  END_HTML */
 ////////////////////////////////////////////////////////////////
@@ -41,6 +44,7 @@ return an rms. The chi squared values are calculated using the chi2() method in
 #include "RooUnfold.h"
 #include "TRandom.h"
 #include "RooUnfoldResponse.h"
+#include "RooUnfoldParallel.h"
 #include "TLatex.h"
 using std::cout;
 using std::cerr;
@@ -67,6 +71,7 @@ RooUnfoldParms::Init()
     _maxparm=unfold->GetMaxParm();
     _minparm=unfold->GetMinParm();
     _stepsizeparm=unfold->GetStepSizeParm();
+    _nthreads=1;
 }
 
 RooUnfoldParms::~RooUnfoldParms()
@@ -118,11 +123,58 @@ RooUnfoldParms::GetRMSResiduals()
     return dynamic_cast<TH1D*>(hrms->Clone());
 }
 
+struct RooUnfoldParms::ScanJob {
+    // Inputs and per-k result table for the parameter scan
+    const RooUnfoldParms* parms;
+    Int_t nt;
+    Int_t overflow;
+    vector<Double_t> k;          // regularisation parameters
+    vector<RooUnfold*> unfolds;  // clones, one per k (some may be unfolded already)
+    vector<Double_t> err;        // mean error
+    vector<Double_t> chi2;       // chi^2 (if hTrue)
+    vector< vector<Double_t> > res;  // residuals of the filled bins (if hTrue)
+};
+
+void
+RooUnfoldParms::ScanTask(Int_t ik, void* arg)
+{
+    //Unfolds and evaluates one regularisation parameter of the scan, using its own clone.
+    ScanJob* job= (ScanJob*) arg;
+    const RooUnfoldParms* p= job->parms;
+    RooUnfold* unf= job->unfolds[ik];
+    Int_t nt= job->nt;
+    Int_t _overflow= job->overflow;
+    Double_t sq_err_tot=0;
+    TH1* hReco=unf->Hreco(p->doerror);
+    for (Int_t i= 0; i < nt; i++)
+    {
+      sq_err_tot += RooUnfoldResponse::GetBinError (hReco, i, _overflow);
+    }
+    job->err[ik]=sq_err_tot/nt;
+    if (p->hTrue)
+    {
+        for (int i=0;i<nt;i++){
+            Int_t j= RooUnfoldResponse::GetBin (hReco, i, _overflow);
+            if (hReco->GetBinContent(j)!=0.0 || (hReco->GetBinError(j)>0.0))
+            {
+                job->res[ik].push_back(hReco->GetBinContent(j) - p->hTrue->GetBinContent(j));
+            }
+        }
+        job->chi2[ik]=unf->Chi2(p->hTrue,p->doerror);
+    }
+    delete hReco;
+    delete unf;
+    job->unfolds[ik]= 0;
+}
+
 void
 RooUnfoldParms::DoMath()
 {
     //Loops over many regularisation parameters and creates plots.
     //Uses minimum, maximum and step size parameters for range of the loop.
+    //The parameters are evaluated (on SetThreads() threads) into a table, one independent clone
+    //per parameter, which is then filled into the plots in parameter order. Where the unfolding
+    //method supports it (RooUnfold::UnfoldRegParms), the clones are unfolded together first.
     Int_t nobins=Int_t((_maxparm-_minparm)/_stepsizeparm);
     Double_t xlo=_minparm;
     Double_t xhi=_maxparm;
@@ -146,54 +198,51 @@ RooUnfoldParms::DoMath()
     }
     
     else{ 
-        vector<TH1D*> graph_vector;    
-        for(Double_t a = _minparm; a<=_maxparm; a+=_stepsizeparm) {
-        TString graph_title("Residuals at k= ");
-        graph_title+=a;
-        TH1D* graph_name = new TH1D (graph_title,graph_title, 200,0,1000);
-        graph_vector.push_back(graph_name);
-        }
-        Int_t gvl=0;
-        Int_t _overflow=unfold->Overflow();
-        Int_t nt = unfold->response()->GetNbinsTruth();
-        if (_overflow) nt += 2;
-    
-        for (Double_t k=_minparm;k<=_maxparm;k+=_stepsizeparm)
-        {   
-            RooUnfold* unf = unfold->Clone("unfold_toy");
-            unf->SetRegParm(k);
-            Double_t sq_err_tot=0;
-            TH1* hReco=unf->Hreco(doerror); 
-            for (Int_t i= 0; i < nt; i++)
-            {
-              sq_err_tot += RooUnfoldResponse::GetBinError (hReco, i, _overflow);
+        ScanJob job;
+        job.parms=this;
+        job.overflow=unfold->Overflow();
+        job.nt=unfold->response()->GetNbinsTruth();
+        if (job.overflow) job.nt += 2;
+        for (Double_t k=_minparm;k<=_maxparm;k+=_stepsizeparm) job.k.push_back(k);
+        Int_t nk=job.k.size();
+        job.unfolds.assign(nk,(RooUnfold*)0);
+        job.err.assign(nk,0.0);
+        job.chi2.assign(nk,0.0);
+        job.res.assign(nk,vector<Double_t>());
+
+        Bool_t oldstat= TH1::AddDirectoryStatus();
+        TH1::AddDirectory (kFALSE);
+        // Clones for each k, made here so that the tasks share nothing they modify.
+        // With several threads, toys each get their own random stream.
+        if (nk>0 && !unfold->UnfoldRegParms(nk,&job.k[0],&job.unfolds[0],doerror)){
+            for (Int_t ik=0; ik<nk; ik++){
+                job.unfolds[ik]=unfold->Clone("unfold_toy");
+                job.unfolds[ik]->SetRegParm(job.k[ik]);
             }
-            herr->Fill(k,sq_err_tot/nt);
+        }
+        if (_nthreads>1 && doerror==RooUnfold::kCovToy && !unfold->ToySeed()){
+            TRandom* rnd= unfold->RandomGenerator() ? unfold->RandomGenerator() : gRandom;
+            UInt_t seed= UInt_t(rnd->Integer(kMaxUInt));
+            for (Int_t ik=0; ik<nk; ik++) job.unfolds[ik]->SetToySeed(RooUnfoldParallel::Seed(seed,ik));
+        }
+        unfold->response()->Vmeasured(); unfold->response()->Emeasured(); unfold->response()->Vfakes();
+        unfold->response()->Vtruth(); unfold->response()->Etruth();
+        unfold->response()->Mresponse(); unfold->response()->Eresponse();
+        RooUnfoldParallel::Run(nk,ScanTask,&job,_nthreads);
+        TH1::AddDirectory (oldstat);
+
+        // Fill the plots from the table, in parameter order
+        for (Int_t ik=0; ik<nk; ik++)
+        {
+            Double_t k=job.k[ik];
+            herr->Fill(k,job.err[ik]);
             if (hTrue)
-            {   
-                Double_t rsqt=0;    
-                Double_t res_tot=0;
-                for (int i=0;i<nt;i++){
-                    Int_t j= RooUnfoldResponse::GetBin (hReco, i, _overflow);
-                    if (hReco->GetBinContent(j)!=0.0 || (hReco->GetBinError(j)>0.0)) 
-                    {
-                        Double_t res=hReco->GetBinContent(j) - hTrue->GetBinContent(j);
-                        //cout <<"res="<<res<<endl;
-                        Double_t rsq=res*res;
-                        rsqt+=rsq;
-                        graph_vector[gvl]->Fill(res);
-                        res_tot+=res;
-                        hres->Fill(k,res);
-                    }
-                }
-                double chi2=unf->Chi2(hTrue,doerror);
-                if (chi2<=1e10){
-                    hch2->Fill(k,chi2);
+            {
+                for (unsigned int i=0; i<job.res[ik].size(); i++) hres->Fill(k,job.res[ik][i]);
+                if (job.chi2[ik]<=1e10){
+                    hch2->Fill(k,job.chi2[ik]);
                 }
-                
             }
-            gvl++;
-            delete unf;
         }
         Double_t bn=_minparm;
         for (int i=0; i<hres->GetNbinsX(); i++){
@@ -201,9 +250,6 @@ RooUnfoldParms::DoMath()
             hrms->Fill(bn,spr);
             bn+=_stepsizeparm;
         }
-        for (unsigned int i=0; i<graph_vector.size(); i++){
-            delete graph_vector[i];
-        }
     }
     _done_math=true;
 }
@@ -228,3 +274,10 @@ RooUnfoldParms::SetStepSizeParm(double size)
     //Sets step size.
     _stepsizeparm=size;
 }
+
+void
+RooUnfoldParms::SetThreads(int nthreads)
+{
+    //Sets the number of threads used to evaluate the regularisation parameters (default 1 = serial).
+    _nthreads= nthreads>1 ? nthreads : 1;
+}
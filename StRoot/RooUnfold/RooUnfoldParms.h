@@ -33,8 +33,11 @@ class RooUnfoldParms : public TNamed {
     void SetMinParm(double min);
     void SetMaxParm(double max);
     void SetStepSizeParm(double size);
+    void SetThreads(int nthreads); // Number of threads for the parameter scan
     
     private:
+    struct ScanJob;
+    static void ScanTask(Int_t ik, void* arg);
     bool _done_math;
     TH1* hrms; // Output plot
     TProfile* hch2; // Output plot
@@ -45,6 +48,7 @@ class RooUnfoldParms : public TNamed {
     Double_t _maxparm; //Maximum parameter
     Double_t _minparm; //Minimum parameter
     Double_t _stepsizeparm; //Step size
+    Int_t _nthreads; //Number of threads (1 = serial)
 public:
     ClassDef (RooUnfoldParms, 0)  // Optimisation of unfolding regularisation parameter
 };
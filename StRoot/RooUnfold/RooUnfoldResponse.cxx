@@ -17,6 +17,7 @@
  Conversely can also convert these vectors and matrices into TH1Ds and TH2Ds. </p>
 <p> Can also take a variety of parameters as inputs. This includes maximum and minimum values, distributions and vectors/matrices of values. </p>
 <p> This class does the numerical modifications needed to allow unfolding techniques to work in the unfolding routines used in RooUnfold. </p>
+<p> Response matrices are often nearly banded (most bins empty). With UseSparse(), ApplyToTruth and RooUnfoldBayes work on the non-zero bins only, using MresponseSparse() or the equivalent row-compressed pattern. </p>
 END_HTML */
 
 /////////////////////////////////////////////////////////////
@@ -26,6 +27,7 @@ END_HTML */
 #include <iostream>
 #include <assert.h>
 #include <cmath>
+#include <vector>
 
 #include "TClass.h"
 #include "TNamed.h"
@@ -37,6 +39,7 @@ END_HTML */
 #include "TF3.h"
 #include "TVectorD.h"
 #include "TMatrixD.h"
+#include "TMatrixDSparse.h"
 #include "TRandom.h"
 #include "TCollection.h"
 
@@ -47,6 +50,7 @@ using std::cerr;
 using std::endl;
 using std::pow;
 using std::sqrt;
+using std::vector;
 
 
 #ifdef HAVE_RooUnfoldFoldingFunction
@@ -232,6 +236,10 @@ RooUnfoldResponse::Reset()
 {
   // Resets object to initial state.
   ClearCache();
+  if (_parent) {  // toy: the histograms belong to the parent
+    delete _resToy;
+    return Setup();
+  }
   delete _mes;
   delete _fak;
   delete _tru;
@@ -243,6 +251,7 @@ RooUnfoldResponse&
 RooUnfoldResponse::Init()
 {
   _overflow= 0;
+  _sparse= 0;
   return Setup();
 }
 
@@ -253,6 +262,10 @@ RooUnfoldResponse::Setup()
   _res= 0;
   _vMes= _eMes= _vFak= _vTru= _eTru= 0;
   _mRes= _eRes= 0;
+  _mResSparse= 0;
+  _parent= 0;
+  _resToy= 0;
+  _resToyOK= false;
   _nm= _nt= _mdim= _tdim= 0;
   _cached= false;
   return *this;
@@ -263,6 +276,7 @@ RooUnfoldResponse::Setup (const RooUnfoldResponse& rhs)
 {
   // Copy data from another RooUnfoldResponse
   _overflow= rhs._overflow;
+  _sparse= rhs._sparse;
   return Setup (rhs.Hmeasured(), rhs.Htruth(), rhs.Hresponse());
 }
 
@@ -431,6 +445,25 @@ RooUnfoldResponse::Setup (const TH1* measured, const TH1* truth, const TH2* resp
   return *this;
 }
 
+void
+RooUnfoldResponse::UseCache (const Double_t* vMes, const Double_t* eMes, const Double_t* vFak, const Double_t* vTru, const Double_t* eTru,
+                             const Double_t* mRes, const Double_t* eRes)
+{
+  // Use vectors and matrices already prepared from these histograms (as Vmeasured(), Emeasured(), Vfakes(),
+  // Vtruth(), Etruth(), Mresponse() and Eresponse() would calculate them), eg. from a memory-mapped cache.
+  // The arrays are not copied, so must stay valid (and unchanged) for the lifetime of this object.
+  // Vectors have GetNbinsMeasured() or GetNbinsTruth() elements; matrices are (measured,truth), row by row.
+  ClearCache();
+  _vMes= new TVectorD; _vMes->Use (_nm, const_cast<Double_t*>(vMes));
+  _eMes= new TVectorD; _eMes->Use (_nm, const_cast<Double_t*>(eMes));
+  _vFak= new TVectorD; _vFak->Use (_nm, const_cast<Double_t*>(vFak));
+  _vTru= new TVectorD; _vTru->Use (_nt, const_cast<Double_t*>(vTru));
+  _eTru= new TVectorD; _eTru->Use (_nt, const_cast<Double_t*>(eTru));
+  _mRes= new TMatrixD; _mRes->Use (_nm, _nt, const_cast<Double_t*>(mRes));
+  _eRes= new TMatrixD; _eRes->Use (_nm, _nt, const_cast<Double_t*>(eRes));
+  _cached= true;
+}
+
 void
 RooUnfoldResponse::ClearCache()
 {
@@ -441,6 +474,7 @@ RooUnfoldResponse::ClearCache()
   delete _eTru; _eTru= 0;
   delete _mRes; _mRes= 0;
   delete _eRes; _eRes= 0;
+  delete _mResSparse; _mResSparse= 0;
   _cached= false;
 }
 
@@ -716,6 +750,51 @@ RooUnfoldResponse::H2M  (const TH2* h, Int_t nx, Int_t ny, const TH1* norm, Bool
   return m;
 }
 
+const TMatrixDSparse&
+RooUnfoldResponse::MresponseSparse() const
+{
+  // Response matrix as a row-compressed TMatrixDSparse: (row,column)=(measured,truth).
+  // Only the non-zero elements are stored.
+  if (!_mResSparse) {
+    if (_parent) _cached= (_mResSparse= new TMatrixDSparse (Mresponse()));  // toy: from its smeared matrix
+    else         _cached= (_mResSparse= H2MSparse (_res, _nm, _nt, _tru, _overflow));
+  }
+  return *_mResSparse;
+}
+
+TMatrixDSparse*
+RooUnfoldResponse::H2MSparse (const TH2* h, Int_t nx, Int_t ny, const TH1* norm, Bool_t overflow)
+{
+  // Returns row-compressed sparse matrix of the non-zero bins in a 2D input histogram.
+  // The matrix only stores (and products with it only touch) the non-zero elements.
+  Int_t first= overflow ? 0 : 1;
+  if (overflow) {
+    nx += 2;
+    ny += 2;
+  }
+  if (!h) return new TMatrixDSparse (nx, ny);
+  vector<Double_t> fac (ny, 1.0);
+  if (norm) {
+    for (Int_t j= 0; j < ny; j++) {
+      fac[j]= GetBinContent (norm, j, overflow);
+      if (fac[j] != 0.0) fac[j]= 1.0/fac[j];
+    }
+  }
+  vector<Int_t>    rows, cols;
+  vector<Double_t> vals;
+  for (Int_t i= 0; i < nx; i++) {
+    for (Int_t j= 0; j < ny; j++) {
+      Double_t v= h->GetBinContent(i+first,j+first) * fac[j];
+      if (v == 0.0) continue;
+      rows.push_back (i);
+      cols.push_back (j);
+      vals.push_back (v);
+    }
+  }
+  if (vals.empty()) return new TMatrixDSparse (nx, ny);
+  return new TMatrixDSparse (0, nx-1, 0, ny-1, vals.size(), &rows[0], &cols[0], &vals[0]);
+}
+
 TMatrixD*
 RooUnfoldResponse::H2ME (const TH2* h, Int_t nx, Int_t ny, const TH1* norm, Bool_t overflow)
 {
@@ -829,7 +908,8 @@ RooUnfoldResponse::ApplyToTruth (const TH1* truth, const char* name) const
     resultvect= new TVectorD (Vtruth());
   }
 
-  (*resultvect) *= Mresponse();   // v= A*v
+  if (_sparse) (*resultvect) *= MresponseSparse();   // v= A*v, skipping empty response bins
+  else         (*resultvect) *= Mresponse();         // v= A*v
 
   // Turn results vector into properly binned histogram
   TH1* result= (TH1*) Hmeasured()->Clone (name);
@@ -888,27 +968,94 @@ TF1* RooUnfoldResponse::MakeFoldingFunction (TF1* func, Double_t eps, Bool_t ver
 }
 
 
-RooUnfoldResponse* RooUnfoldResponse::RunToy() const
+RooUnfoldResponse* RooUnfoldResponse::RunToy (TRandom* rnd, RooUnfoldResponse* toy) const
 {
   // Returns new RooUnfoldResponse object with smeared response matrix elements for use as a toy.
-  TString name= GetName();
-  name += "_toy";
-  RooUnfoldResponse* res= new RooUnfoldResponse (*this);
-  res->SetName(name);
-  if (!FakeEntries()) _fak->Reset();
-  TH2* hres= res->Hresponse();
+  // Uses the random number generator rnd, or gRandom if not specified.
+  // The toy only holds its smeared Mresponse() matrix: the measured, fakes, and truth histograms,
+  // their vectors, and Eresponse() are shared with this object, which must not be changed or deleted
+  // while the toy is in use. The toy itself should only be read. Its response histogram is only made
+  // if it is asked for (by RooUnfoldBayes and RooUnfoldSvd, say).
+  // A toy returned by an earlier call can be passed as toy to refill it, reusing its matrix
+  // and response histogram (any other RooUnfoldResponse passed as toy is reset and made into a toy).
+  if (!rnd) rnd= gRandom;
+  if (!toy) toy= new RooUnfoldResponse();
+  if (toy->_parent != this) {
+    TString name= GetName();
+    name += "_toy";
+    toy->Reset();
+    toy->SetNameTitle (name, GetTitle());
+    toy->_parent= this;
+    toy->_mes= _mes;
+    toy->_fak= _fak;
+    toy->_tru= _tru;
+    toy->_mdim= _mdim;
+    toy->_tdim= _tdim;
+    toy->_nm= _nm;
+    toy->_nt= _nt;
+    toy->_overflow= _overflow;
+    toy->_sparse= _sparse;
+  }
+  toy->_resToyOK= false;   // refilled in place when next asked for
+  delete toy->_mResSparse; toy->_mResSparse= 0;
+
+  // Smear the unnormalised contents, as the response histogram would be, but work directly on
+  // the normalised matrices: content = Mresponse*truth, error = Eresponse*truth.
+  const TMatrixD& m= Mresponse();
+  const TMatrixD& e= Eresponse();
+  const TVectorD& t= Vtruth();
+  if (toy->_mRes) *toy->_mRes= m;
+  else             toy->_mRes= new TMatrixD (m);
+  toy->_cached= true;
+  TMatrixD& mtoy= *toy->_mRes;
+  const TH2* hres= 0;
+  Int_t first= _overflow ? 0 : 1;
   for (Int_t i= 1; i<=_nm; i++) {
+    Int_t ii= i-first;
     for (Int_t j= 1; j<=_nt; j++) {
-      Int_t bin= hres->GetBin (i,j);
-      Double_t e= hres->GetBinError (bin);
-      if (e>0.0) {
-        Double_t v= hres->GetBinContent(bin) + gRandom->Gaus(0.0,e);
+      Int_t jj= j-first;
+      Double_t tj= t[jj];
+      if (tj == 0.0) {
+        // Empty truth bin: the matrix column stays zero, but use up the same random numbers.
+        if (!hres) hres= Hresponse();
+        Double_t ej= hres->GetBinError (hres->GetBin (i,j));
+        if (ej>0.0) rnd->Gaus(0.0,ej);
+        continue;
+      }
+      Double_t ej= e(ii,jj)*tj;
+      if (ej>0.0) {
+        Double_t v= m(ii,jj)*tj + rnd->Gaus(0.0,ej);
         if (v<0.0) v= 0.0;
-        hres->SetBinContent (bin, v);
+        mtoy(ii,jj)= v/tj;
       }
     }
   }
-  return res;
+  return toy;
+}
+
+TH2*
+RooUnfoldResponse::ToyHresponse() const
+{
+  // Response histogram of a toy, filled from its smeared matrix on first use after each
+  // RunToy(). The histogram is kept and refilled in place for the next toy.
+  // Columns for empty truth bins keep the parent's contents (they are not used).
+  if (_resToyOK) return _resToy;
+  if (!_resToy) {
+    Bool_t oldstat= TH1::AddDirectoryStatus();
+    TH1::AddDirectory (kFALSE);
+    _resToy= (TH2*) _parent->Hresponse()->Clone (GetName());
+    TH1::AddDirectory (oldstat);
+  }
+  _resToyOK= true;
+  const TMatrixD& m= Mresponse();
+  const TVectorD& t= Vtruth();
+  Int_t first= _overflow ? 0 : 1;
+  for (Int_t j= 1; j<=_nt; j++) {
+    Double_t tj= t[j-first];
+    if (tj == 0.0) continue;
+    for (Int_t i= 1; i<=_nm; i++) _resToy->SetBinContent (i, j, m(i-first,j-first)*tj);
+  }
+  return _resToy;
 }
 
 void
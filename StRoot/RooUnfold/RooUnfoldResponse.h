@@ -16,11 +16,13 @@
 #include "TMatrixD.h"
 #include "TH1.h"
 #include "TVectorDfwd.h"
+#include "TMatrixDSparsefwd.h"
 class TF1;
 class TH2;
 class TH2D;
 class TAxis;
 class TCollection;
+class TRandom;
 
 class RooUnfoldResponse : public TNamed {
 
@@ -94,11 +96,15 @@ public:
   const TVectorD& Etruth()            const;   // Truth distribution errors as a TVectorD
   const TMatrixD& Mresponse()         const;   // Response matrix as a TMatrixD: (row,column)=(measured,truth)
   const TMatrixD& Eresponse()         const;   // Response matrix errors as a TMatrixD: (row,column)=(measured,truth)
+  const TMatrixDSparse& MresponseSparse() const; // Response matrix as a row-compressed TMatrixDSparse (non-zero elements only)
 
   Double_t operator() (Int_t r, Int_t t) const;// Response matrix element (measured,truth)
 
   void   UseOverflow (Bool_t set= kTRUE);      // Specify to use overflow bins
   Bool_t UseOverflowStatus() const;            // Get UseOverflow setting
+  void   UseSparse (Bool_t set= kTRUE);        // Specify to skip the empty response bins where supported (ApplyToTruth, RooUnfoldBayes)
+  Bool_t UseSparseStatus() const;              // Get UseSparse setting
+  Bool_t IsToy() const;                        // Is this a toy made by RunToy()?
   Double_t FakeEntries() const;                // Return number of bins with fakes
   virtual void Print (Option_t* option="") const;
 
@@ -107,6 +113,7 @@ public:
   static TVectorD* H2VE (const TH1*  h, Int_t nb, Bool_t overflow= kFALSE);
   static TMatrixD* H2M  (const TH2*  h, Int_t nx, Int_t ny, const TH1* norm= 0, Bool_t overflow= kFALSE);
   static TMatrixD* H2ME (const TH2*  h, Int_t nx, Int_t ny, const TH1* norm= 0, Bool_t overflow= kFALSE);
+  static TMatrixDSparse* H2MSparse (const TH2* h, Int_t nx, Int_t ny, const TH1* norm= 0, Bool_t overflow= kFALSE);
   static void      V2H  (const TVectorD& v, TH1* h, Int_t nb, Bool_t overflow= kFALSE);
   static Int_t   FindBin(const TH1*  h, Double_t x);  // return vector index for bin containing (x)
   static Int_t   FindBin(const TH1*  h, Double_t x, Double_t y);  // return vector index for bin containing (x,y)
@@ -119,13 +126,16 @@ public:
   TH1* ApplyToTruth (const TH1* truth= 0, const char* name= "AppliedResponse") const; // If argument is 0, applies itself to its own truth
   TF1* MakeFoldingFunction (TF1* func, Double_t eps=1e-12, Bool_t verbose=false) const;
 
-  RooUnfoldResponse* RunToy() const;
+  RooUnfoldResponse* RunToy (TRandom* rnd= 0, RooUnfoldResponse* toy= 0) const;  // Toy sharing this object's histograms; refills toy if given
+  void UseCache (const Double_t* vMes, const Double_t* eMes, const Double_t* vFak, const Double_t* vTru, const Double_t* eTru,
+                 const Double_t* mRes, const Double_t* eRes);  // Use prepared vectors/matrices held elsewhere (eg. memory-mapped)
 
 private:
 
   virtual RooUnfoldResponse& Init();
   virtual RooUnfoldResponse& Setup();
   virtual void ClearCache();
+  TH2* ToyHresponse() const;
   virtual void SetNameTitleDefault (const char* defname= 0, const char* deftitle= 0);
   virtual Int_t Miss1D (Double_t xt, Double_t w= 1.0);  // Fill missed event into 1D Response Matrix (with weight)
   virtual Int_t Miss2D (Double_t xt, Double_t yt, Double_t w= 1.0);  // Fill missed event into 2D Response Matrix (with weight)
@@ -146,6 +156,7 @@ private:
   TH1*  _tru;      // Truth    histogram
   TH2*  _res;      // Response histogram
   Int_t _overflow; // Use histogram under/overflows if 1
+  Int_t _sparse;   // Use sparse response matrix if 1
 
   mutable TVectorD* _vMes;   //! Cached measured vector
   mutable TVectorD* _eMes;   //! Cached measured error
@@ -154,11 +165,15 @@ private:
   mutable TVectorD* _eTru;   //! Cached truth    error
   mutable TMatrixD* _mRes;   //! Cached response matrix
   mutable TMatrixD* _eRes;   //! Cached response error
+  mutable TMatrixDSparse* _mResSparse; //! Cached sparse response matrix
   mutable Bool_t    _cached; //! We are using cached vectors/matrices
+  const RooUnfoldResponse* _parent; //! Response this toy was made from (owns the histograms)
+  mutable TH2*      _resToy; //! Toy response histogram, only made if asked for
+  mutable Bool_t    _resToyOK; //! Toy response histogram has been refilled for the current toy
 
 public:
 
-  ClassDef (RooUnfoldResponse, 1) // Respose Matrix
+  ClassDef (RooUnfoldResponse, 2) // Respose Matrix
 };
 
 // Inline method definitions
@@ -278,13 +293,13 @@ inline
 const TH2*   RooUnfoldResponse::Hresponse() const
 {
   // Response matrix as a 2D-histogram: (x,y)=(measured,truth)
-  return _res;
+  return _parent ? ToyHresponse() : _res;
 }
 
 inline
 TH2*         RooUnfoldResponse::Hresponse()
 {
-  return _res;
+  return _parent ? ToyHresponse() : _res;
 }
 
 
@@ -292,6 +307,7 @@ inline
 const TVectorD& RooUnfoldResponse::Vmeasured() const
 {
   // Measured distribution as a TVectorD
+  if (_parent) return _parent->Vmeasured();
   if (!_vMes) _cached= (_vMes= H2V  (_mes, _nm, _overflow));
   return *_vMes;
 }
@@ -300,6 +316,7 @@ inline
 const TVectorD& RooUnfoldResponse::Vfakes() const
 {
   // Fakes distribution as a TVectorD
+  if (_parent) return _parent->Vfakes();
   if (!_vFak) _cached= (_vFak= H2V  (_fak, _nm, _overflow));
   return *_vFak;
 }
@@ -308,6 +325,7 @@ inline
 const TVectorD& RooUnfoldResponse::Emeasured() const
 {
   // Measured distribution errors as a TVectorD
+  if (_parent) return _parent->Emeasured();
   if (!_eMes) _cached= (_eMes= H2VE (_mes, _nm, _overflow));
   return *_eMes;
 }
@@ -316,6 +334,7 @@ inline
 const TVectorD& RooUnfoldResponse::Vtruth() const
 {
   // Truth distribution as a TVectorD
+  if (_parent) return _parent->Vtruth();
   if (!_vTru) _cached= (_vTru= H2V  (_tru, _nt, _overflow)); 
   return *_vTru;
 }
@@ -324,6 +343,7 @@ inline
 const TVectorD& RooUnfoldResponse::Etruth() const
 {
   // Truth distribution errors as a TVectorD
+  if (_parent) return _parent->Etruth();
   if (!_eTru) _cached= (_eTru= H2VE (_tru, _nt, _overflow)); 
   return *_eTru;
 }
@@ -340,6 +360,7 @@ inline
 const TMatrixD& RooUnfoldResponse::Eresponse() const
 {
   // Response matrix errors as a TMatrixD: (row,column)=(measured,truth)
+  if (_parent) return _parent->Eresponse();
   if (!_eRes) _cached= (_eRes= H2ME (_res, _nm, _nt, _tru, _overflow)); 
   return *_eRes;
 }
@@ -433,6 +454,28 @@ Bool_t RooUnfoldResponse::UseOverflowStatus() const
   return _overflow;
 }
 
+inline
+void RooUnfoldResponse::UseSparse (Bool_t set)
+{
+  // Specify to use the sparse response matrix (MresponseSparse()) where supported, so that
+  // the work for (nearly) banded responses scales with the number of non-zero bins.
+  _sparse= (set ? 1 : 0);
+}
+
+inline
+Bool_t RooUnfoldResponse::UseSparseStatus() const
+{
+  // Get UseSparse setting
+  return _sparse;
+}
+
+inline
+Bool_t RooUnfoldResponse::IsToy() const
+{
+  // Is this a toy made by RunToy()? A toy only holds its smeared Mresponse().
+  return _parent!=0;
+}
+
 inline
 Double_t RooUnfoldResponse::FakeEntries() const
 {
@@ -24,6 +24,7 @@ END_HTML */
 
 #include <iostream>
 #include <iomanip>
+#include <vector>
 
 #include "TClass.h"
 #include "TNamed.h"
@@ -34,6 +35,7 @@ END_HTML */
 #include "TSVDUnfold_local.h"  /* Use local copy of TSVDUnfold.h */
 
 #include "RooUnfoldResponse.h"
+#include "RooUnfoldParallel.h"
 
 using std::cout;
 using std::cerr;
@@ -194,6 +196,84 @@ RooUnfoldSvd::Unfold()
   _haveCov=  false;
 }
 
+Bool_t
+RooUnfoldSvd::IsLinear() const
+{
+  // For fixed kreg, TSVDUnfold's result is linear in the measured distribution
+  return true;
+}
+
+Bool_t
+RooUnfoldSvd::EffectiveMatrix (TMatrixD& m)
+{
+  // Unfolding matrix: TSVDUnfold's unfolding matrix for _kreg, applied after subtracting the fakes
+  if (_dosys) return false;
+  Vreco();
+  if (!_unfolded || !_svd) return false;
+  TMatrixD msvd;
+  if (!_svd->GetUnfoldMatrix (_kreg, msvd)) return false;
+  TMatrixD mnt (msvd.GetSub (0, _nt-1, 0, _nm-1));
+  m.ResizeTo(_nt,_nm);
+  m.Mult (mnt, FakesMatrix());
+  return true;
+}
+
+Bool_t
+RooUnfoldSvd::UnfoldRegParms (Int_t n, const Double_t* parms, RooUnfold** unfolds, ErrorTreatment withError) const
+{
+  // Unfolded clones for n values of kreg parms[0..n-1], all from one decomposition
+  // (TSVDUnfold::Unfold for several kreg). The inverse covariance does not depend on kreg,
+  // so it is shared too. Not with IncludeSystematics or kCovToy errors, which need toys for each kreg.
+  if (_dosys) return kFALSE;
+  if (withError!=kNoError && withError!=kErrors && withError!=kCovariance) return kFALSE;
+  RooUnfoldSvd* all= Clone (GetName());
+  all->Vreco();
+  if (!all->_unfolded || !all->_svd) {
+    delete all;
+    return kFALSE;
+  }
+  std::vector<Int_t> kreg (n);
+  for (Int_t i= 0; i<n; i++) {
+    kreg[i]= Int_t(parms[i]+0.5);
+    if (kreg[i] < 0 || kreg[i] > all->_nb) {
+      delete all;
+      return kFALSE;
+    }
+  }
+
+  Bool_t oldstat= TH1::AddDirectoryStatus();
+  TH1::AddDirectory (kFALSE);
+  Bool_t docov= (withError!=kNoError);
+  std::vector<TH1D*> rechist (n, (TH1D*)0);
+  std::vector<TH2D*> xtau    (n, (TH2D*)0);
+  all->_svd->Unfold (n, &kreg[0], &rechist[0], docov ? &xtau[0] : 0);
+  const TH2D* xinv= all->_svd->GetXinv();
+  for (Int_t k= 0; k<n; k++) {
+    RooUnfoldSvd* unfold= Clone (GetName());
+    unfold->SetKterm (kreg[k]);
+    unfold->_rec.ResizeTo (_nt);
+    for (Int_t i= 0; i<_nt; i++) unfold->_rec[i]= rechist[k]->GetBinContent(i+1);
+    if (docov) {
+      unfold->_cov.ResizeTo (_nt, _nt);
+      unfold->_wgt.ResizeTo (_nt, _nt);
+      for (Int_t i= 0; i<_nt; i++) {
+        for (Int_t j= 0; j<_nt; j++) {
+          unfold->_cov(i,j)= xtau[k]->GetBinContent(i+1,j+1);
+          unfold->_wgt(i,j)= xinv   ->GetBinContent(i+1,j+1);
+        }
+      }
+      unfold->_haveCov= unfold->_haveWgt= true;
+    }
+    unfold->_unfolded= true;
+    unfolds[k]= unfold;
+    delete rechist[k];
+    delete xtau[k];
+  }
+  TH1::AddDirectory (oldstat);
+  delete all;
+  return kTRUE;
+}
+
 void
 RooUnfoldSvd::GetCov()
 {
@@ -206,7 +286,16 @@ RooUnfoldSvd::GetCov()
   if (_dosys!=2) unfoldedCov= _svd->GetXtau();
   //Get the covariance matrix for statistical uncertainties on the response matrix
   //Uses Poisson or Gaussian-distributed toys, depending on response matrix histogram's Sumw2 setting.
-  if (_dosys)        adetCov= _svd->GetAdetCovMatrix (_NToys);
+  //The toys run on ToyThreads() threads, if set, and use their own streams with ToySeed().
+  if (_dosys) {
+    Int_t seed= 1;
+    if (_toyseed) {
+      seed= Int_t (RooUnfoldParallel::Seed (_toyseed, RooUnfoldParallel::Key ("RooUnfoldSvd::GetAdetCovMatrix"), 0));
+      _svd->SetNThreads (_nthreads>1 ? _nthreads : -1);
+    } else
+      _svd->SetNThreads (_nthreads);
+    adetCov= _svd->GetAdetCovMatrix (_NToys, seed);
+  }
 
   _cov.ResizeTo (_nt, _nt);
   for (Int_t i= 0; i<_nt; i++) {
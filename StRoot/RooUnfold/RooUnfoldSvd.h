@@ -48,6 +48,9 @@ public:
   virtual void  SetRegParm (Double_t parm);
   virtual Double_t GetRegParm() const;
   virtual void Reset();
+  virtual Bool_t IsLinear() const;
+  virtual Bool_t EffectiveMatrix (TMatrixD& m);
+  virtual Bool_t UnfoldRegParms (Int_t n, const Double_t* parms, RooUnfold** unfolds, ErrorTreatment withError) const;
   TSVDUnfold* Impl();
 
   void SetNtoysSVD (Int_t ntoyssvd);  // no longer used
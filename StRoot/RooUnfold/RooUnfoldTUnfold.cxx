@@ -18,6 +18,10 @@
 <p>Errors come as a full covariance matrix.
 <p>Will sometimes warn of "unlinked" bins. These are bins with 0 entries and do not effect the results of the unfolding
 <p>Regularisation parameter can be either optimised internally by plotting log10(chi2 squared) against log10(tau). The 'kink' in this curve is deemed the optimum tau value. This value can also be set manually (FixTau)
+<p>By default the kink is found with TUnfold::ScanLcurve (30 points, SetTauScan to change). SetFastScan uses a
+coarse grid in log10(tau) that is refined around the largest curvature, which needs about half as many unfoldings.
+With SetTauScan(n,nthreads), the n points of the full scan are evenly spaced in log10(tau) and unfolded on nthreads threads.
+<p>Copies of an unfolding object (including the toys used for the errors) use the tau chosen by its L-curve scan, rather than scanning again.
 <p>The latest version (TUnfold 15 in ROOT 2.27.04) will not handle plots with an additional underflow bin. As a result overflows must be turned off
 if v15 of TUnfold is used. ROOT versions 5.26 or below use v13 and so should be safe to use overflows.</ul>
 END_HTML */
@@ -27,6 +31,8 @@ END_HTML */
 #include "RooUnfoldTUnfold.h"
 
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include "TH1.h"
 #include "TH2.h"
@@ -39,8 +45,10 @@ END_HTML */
 #endif
 #include "TGraph.h"
 #include "TSpline.h"
+#include "TMath.h"
 
 #include "RooUnfoldResponse.h"
+#include "RooUnfoldParallel.h"
 
 using std::cout;
 using std::cerr;
@@ -48,6 +56,16 @@ using std::endl;
 
 ClassImp (RooUnfoldTUnfold);
 
+struct RooUnfoldTUnfold::ScanJob {
+  // Points of the L-curve scan, shared by the tasks of ScanLcurveParallel
+  const RooUnfoldTUnfold* unfold;
+  const TH2D* Hres;
+  const TH1D* meas;
+  Int_t n, nblock;
+  const Double_t* logTau;
+  Double_t *x, *y;
+};
+
 RooUnfoldTUnfold::RooUnfoldTUnfold (const RooUnfoldTUnfold& rhs)
   : RooUnfold (rhs)
 {
@@ -114,18 +132,32 @@ RooUnfoldTUnfold::CopyData (const RooUnfoldTUnfold& rhs)
 {
   tau_set=rhs.tau_set;
   _tau=rhs._tau;
+  _nScan=rhs._nScan;
+  _fastScan=rhs._fastScan;
+  _nthreadsScan=rhs._nthreadsScan;
   _reg_method=rhs._reg_method;
   _lCurve  = (rhs._lCurve  ? dynamic_cast<TGraph*> (rhs._lCurve ->Clone()) : 0);
   _logTauX = (rhs._logTauX ? dynamic_cast<TSpline*>(rhs._logTauX->Clone()) : 0);
   _logTauY = (rhs._logTauY ? dynamic_cast<TSpline*>(rhs._logTauY->Clone()) : 0);
 }
 
+void
+RooUnfoldTUnfold::SetupToy (RooUnfold* toy) const
+{
+  // Toys use the tau chosen by our L-curve scan, rather than repeating the scan for each toy
+  if (!tau_set && _tauScanned) ((RooUnfoldTUnfold*) toy)->FixTau (_tau);
+}
+
 
 void
 RooUnfoldTUnfold::Init()
 {
   tau_set=false;
   _tau=0;
+  _nScan=30;
+  _fastScan=false;
+  _nthreadsScan=1;
+  _tauScanned=false;
   _unf=0;
   _lCurve = 0;
   _logTauX = 0;
@@ -194,39 +226,8 @@ RooUnfoldTUnfold::Unfold()
       meas->SetBinContent (i, meas->GetBinContent(i)-(fac*fakes[i-1]));
   }
 
-  Int_t ndim= _meas->GetDimension();
-  TUnfold::ERegMode reg= _reg_method;
-  if (ndim == 2 || ndim == 3) reg= TUnfold::kRegModeNone;  // set explicitly
-
-#ifndef NOTUNFOLDSYS
-  if (_dosys)
-    _unf= new TUnfoldSys(Hres,TUnfold::kHistMapOutputVert,reg);
-  else
-#endif
-    _unf= new TUnfold(Hres,TUnfold::kHistMapOutputVert,reg);
+  _unf= MakeTUnfold (Hres, _dosys);
 
-  if        (ndim == 2) {
-    Int_t nx= _meas->GetNbinsX(), ny= _meas->GetNbinsY();
-    _unf->RegularizeBins2D (0, 1, nx, nx, ny, _reg_method);
-  } else if (ndim == 3) {
-    Int_t nx= _meas->GetNbinsX(), ny= _meas->GetNbinsY(), nz= _meas->GetNbinsZ(), nxy= nx*ny;
-    for (Int_t i= 0; i<nx; i++) {
-      _unf->RegularizeBins2D (    i, nx, ny, nxy, nz, _reg_method);
-    }
-    for (Int_t i= 0; i<ny; i++) {
-      _unf->RegularizeBins2D ( nx*i,  1, nx, nxy, nz, _reg_method);
-    }
-    for (Int_t i= 0; i<nz; i++) {
-      _unf->RegularizeBins2D (nxy*i,  1, nx,  nx, ny, _reg_method);
-    }
-  }
-
-  Int_t nScan=30;
-  // use automatic L-curve scan: start with taumin=taumax=0.0
-  Double_t tauMin=0.0;
-  Double_t tauMax=0.0;
-  // this method scans the parameter tau and finds the kink in the L curve
-  // finally, the unfolding is done for the best choice of tau
   Int_t stat= _unf->SetInput(meas);
   if(stat>=10000) {
     cerr<<"Unfolding result may be wrong: " << stat/10000 << " unconstrained output bins\n";
@@ -236,9 +237,25 @@ RooUnfoldTUnfold::Unfold()
     delete _lCurve;  _lCurve  = 0;
     delete _logTauX; _logTauX = 0;
     delete _logTauY; _logTauY = 0;
-    Int_t bestPoint = _unf->ScanLcurve(nScan,tauMin,tauMax,&_lCurve,&_logTauX,&_logTauY);
-    _tau=_unf->GetTau();  // save value, even if we don't use it unless tau_set
-    cout <<"Lcurve scan chose tau= "<<_tau<<endl<<" at point "<<bestPoint<<endl;
+    if (_fastScan) {
+      ScanLcurveFast();
+      _tau=_unf->GetTau();
+      cout <<"Lcurve search chose tau= "<<_tau<<endl;
+    } else if (_nthreadsScan>1) {
+      ScanLcurveParallel (Hres, meas);
+      _tau=_unf->GetTau();
+      cout <<"Lcurve scan chose tau= "<<_tau<<endl;
+    } else {
+      // use automatic L-curve scan: start with taumin=taumax=0.0
+      Double_t tauMin=0.0;
+      Double_t tauMax=0.0;
+      // this method scans the parameter tau and finds the kink in the L curve
+      // finally, the unfolding is done for the best choice of tau
+      Int_t bestPoint = _unf->ScanLcurve(_nScan,tauMin,tauMax,&_lCurve,&_logTauX,&_logTauY);
+      _tau=_unf->GetTau();  // save value, even if we don't use it unless tau_set
+      cout <<"Lcurve scan chose tau= "<<_tau<<endl<<" at point "<<bestPoint<<endl;
+    }
+    _tauScanned=true;
   }
   else{
     _unf->DoUnfold(_tau);
@@ -264,6 +281,203 @@ RooUnfoldTUnfold::Unfold()
   _haveCov=  false;
 }
 
+TUnfold*
+RooUnfoldTUnfold::MakeTUnfold (const TH2D* Hres, Bool_t sys) const
+{
+  // Create a TUnfold (or TUnfoldSys if sys) object for response Hres (with the
+  // inefficiencies in the measured overflow bin), with our regularisation.
+  Int_t ndim= _meas->GetDimension();
+  TUnfold::ERegMode reg= _reg_method;
+  if (ndim == 2 || ndim == 3) reg= TUnfold::kRegModeNone;  // set explicitly
+
+  TUnfold* unf;
+#ifndef NOTUNFOLDSYS
+  if (sys)
+    unf= new TUnfoldSys(Hres,TUnfold::kHistMapOutputVert,reg);
+  else
+#endif
+    unf= new TUnfold(Hres,TUnfold::kHistMapOutputVert,reg);
+
+  if        (ndim == 2) {
+    Int_t nx= _meas->GetNbinsX(), ny= _meas->GetNbinsY();
+    unf->RegularizeBins2D (0, 1, nx, nx, ny, _reg_method);
+  } else if (ndim == 3) {
+    Int_t nx= _meas->GetNbinsX(), ny= _meas->GetNbinsY(), nz= _meas->GetNbinsZ(), nxy= nx*ny;
+    for (Int_t i= 0; i<nx; i++) {
+      unf->RegularizeBins2D (    i, nx, ny, nxy, nz, _reg_method);
+    }
+    for (Int_t i= 0; i<ny; i++) {
+      unf->RegularizeBins2D ( nx*i,  1, nx, nxy, nz, _reg_method);
+    }
+    for (Int_t i= 0; i<nz; i++) {
+      unf->RegularizeBins2D (nxy*i,  1, nx,  nx, ny, _reg_method);
+    }
+  }
+  return unf;
+}
+
+Bool_t
+RooUnfoldTUnfold::TauRange (Double_t& logTauMin, Double_t& logTauMax)
+{
+  // Range of log10(tau) for the L-curve search, chosen as in TUnfold::ScanLcurve:
+  // at the largest tau, chi2A is of the order of chi2L; at the smallest, the
+  // result is within 1% of the unregularised one.
+  _unf->DoUnfold(0.0);
+  if (_unf->GetNdf()<=0) cerr << "Too few input bins for the L-curve scan, NDF=" << _unf->GetNdf() << endl;
+  Double_t x0= _unf->GetLcurveX(), y0= _unf->GetLcurveY();
+  if (!TMath::Finite(x0) || !TMath::Finite(y0)) {
+    cerr << "L-curve of unregularised unfolding is not finite (X=" << x0 << ", Y=" << y0 << ")" << endl;
+    return false;
+  }
+  logTauMax= 0.5*(TMath::Log10(_unf->GetChi2A()+3.0*TMath::Sqrt(_unf->GetNdf()+1.0))-y0);
+  logTauMin= logTauMax;
+  for (Int_t i= 0; i<10; i++) {
+    logTauMin -= 1.0;
+    _unf->DoUnfold (TMath::Power(10.0,logTauMin));
+    if (_unf->GetLcurveX()-x0 <= 0.00432) break;  // log10(1.01)
+  }
+  return true;
+}
+
+Double_t
+RooUnfoldTUnfold::Curvature (const Double_t* t, const Double_t* x, const Double_t* y)
+{
+  // Curvature of the L-curve (x(t),y(t)) at t[1], from three points t[0]<t[1]<t[2]
+  Double_t h0= t[1]-t[0], h1= t[2]-t[1], h= h0+h1;
+  Double_t xd=  (-h1/(h0*h)) * x[0] + ((h1-h0)/(h0*h1)) * x[1] + (h0/(h1*h)) * x[2];
+  Double_t yd=  (-h1/(h0*h)) * y[0] + ((h1-h0)/(h0*h1)) * y[1] + (h0/(h1*h)) * y[2];
+  Double_t xdd= 2.0 * (x[0]/(h0*h) - x[1]/(h0*h1) + x[2]/(h1*h));
+  Double_t ydd= 2.0 * (y[0]/(h0*h) - y[1]/(h0*h1) + y[2]/(h1*h));
+  Double_t d= xd*xd + yd*yd;
+  if (d<=0.0) return 0.0;
+  return (xd*ydd - yd*xdd) / TMath::Power(d,1.5);
+}
+
+void
+RooUnfoldTUnfold::ScanLcurveFast()
+{
+  // Find the kink of the L-curve on a coarse grid in log10(tau), then halve the
+  // step around the point of largest curvature a few times. The points are kept
+  // on the finest grid, indexed by k, so the neighbours of each point exist.
+  const Int_t ncoarse= 5, nrefine= 3, nfine= 1<<nrefine;
+  Double_t logTauMin, logTauMax;
+  if (!TauRange (logTauMin, logTauMax)) {
+    _unf->DoUnfold(0.0);
+    return;
+  }
+  Double_t dt= (logTauMax-logTauMin) / ((ncoarse-1)*nfine);
+  std::map<Int_t,std::pair<Double_t,Double_t> > curve;  // k -> (x,y) at log10(tau)= logTauMin+k*dt
+  Int_t step= nfine, best= -1;
+  std::vector<Int_t> todo;
+  for (Int_t i= 0; i<ncoarse; i++) todo.push_back (i*step);
+  for (Int_t r= 0; r<=nrefine; r++) {
+    for (size_t i= 0; i<todo.size(); i++) {
+      Int_t k= todo[i];
+      if (curve.count(k)) continue;
+      _unf->DoUnfold (TMath::Power(10.0,logTauMin+k*dt));
+      curve[k]= std::make_pair (_unf->GetLcurveX(), _unf->GetLcurveY());
+    }
+    Int_t kbest= -1;
+    Double_t cmax= 0.0;
+    for (size_t i= 0; i<todo.size(); i++) {
+      Int_t k= todo[i];
+      if (k-step<0 || k+step>(ncoarse-1)*nfine) continue;
+      Double_t t[3], x[3], y[3];
+      for (Int_t j= 0; j<3; j++) {
+        Int_t kj= k+(j-1)*step;
+        t[j]= kj*dt;
+        x[j]= curve[kj].first;
+        y[j]= curve[kj].second;
+      }
+      Double_t c= Curvature (t, x, y);
+      if (kbest<0 || c>cmax) {
+        kbest= k;
+        cmax= c;
+      }
+    }
+    best= kbest;
+    if (r==nrefine) break;
+    step /= 2;
+    todo.clear();
+    todo.push_back (best-step);
+    todo.push_back (best);
+    todo.push_back (best+step);
+  }
+  _unf->DoUnfold (TMath::Power(10.0,logTauMin+best*dt));
+
+  std::vector<Double_t> logTau, x, y;
+  for (std::map<Int_t,std::pair<Double_t,Double_t> >::const_iterator it= curve.begin(); it!=curve.end(); it++) {
+    logTau.push_back (logTauMin+it->first*dt);
+    x.push_back (it->second.first);
+    y.push_back (it->second.second);
+  }
+  SaveLcurve (logTau.size(), &logTau[0], &x[0], &y[0]);
+}
+
+void
+RooUnfoldTUnfold::ScanTask (Int_t iblock, void* arg)
+{
+  // Unfold one block of the points of the L-curve scan with its own TUnfold object
+  ScanJob& job= *static_cast<ScanJob*>(arg);
+  Int_t first= (iblock*job.n)/job.nblock, last= ((iblock+1)*job.n)/job.nblock;
+  TUnfold* unf= job.unfold->MakeTUnfold (job.Hres);
+  unf->SetInput (job.meas);
+  for (Int_t i= first; i<last; i++) {
+    unf->DoUnfold (TMath::Power(10.0,job.logTau[i]));
+    job.x[i]= unf->GetLcurveX();
+    job.y[i]= unf->GetLcurveY();
+  }
+  delete unf;
+}
+
+void
+RooUnfoldTUnfold::ScanLcurveParallel (const TH2D* Hres, const TH1D* meas)
+{
+  // Full L-curve scan with _nScan points evenly spaced in log10(tau), unfolded in
+  // blocks on _nthreadsScan threads. Finally _unf is unfolded at the kink.
+  Double_t logTauMin, logTauMax;
+  if (!TauRange (logTauMin, logTauMax)) {
+    _unf->DoUnfold(0.0);
+    return;
+  }
+  Int_t n= _nScan;
+  std::vector<Double_t> logTau(n), x(n), y(n);
+  for (Int_t i= 0; i<n; i++) logTau[i]= logTauMin + i*(logTauMax-logTauMin)/(n-1);
+
+  ScanJob job;
+  job.unfold= this;
+  job.Hres=   Hres;
+  job.meas=   meas;
+  job.n=      n;
+  job.nblock= TMath::Min (_nthreadsScan, n);
+  job.logTau= &logTau[0];
+  job.x=      &x[0];
+  job.y=      &y[0];
+  RooUnfoldParallel::Run (job.nblock, ScanTask, &job, _nthreadsScan);
+
+  Int_t best= 1;
+  Double_t cmax= 0.0;
+  for (Int_t i= 1; i<n-1; i++) {
+    Double_t c= Curvature (&logTau[i-1], &x[i-1], &y[i-1]);
+    if (i==1 || c>cmax) {
+      best= i;
+      cmax= c;
+    }
+  }
+  _unf->DoUnfold (TMath::Power(10.0,logTau[best]));
+  SaveLcurve (n, &logTau[0], &x[0], &y[0]);
+}
+
+void
+RooUnfoldTUnfold::SaveLcurve (Int_t n, const Double_t* logTau, const Double_t* x, const Double_t* y)
+{
+  // Keep the scanned points as the L curve and splines of x and y vs log10(tau)
+  _lCurve= new TGraph (n, x, y);
+  TGraph gx (n, logTau, x), gy (n, logTau, y);
+  _logTauX= new TSpline3 ("log(chi**2) vs log(tau)", &gx);
+  _logTauY= new TSpline3 ("log(reg.cond) vs log(tau)", &gy);
+}
+
 void
 RooUnfoldTUnfold::GetCov()
 {
@@ -320,6 +534,25 @@ RooUnfoldTUnfold::OptimiseTau()
 {
   // Choose optimal regularisation parameter
   tau_set=false;
+  _tauScanned=false;
+}
+
+void
+RooUnfoldTUnfold::SetTauScan (Int_t nscan, Int_t nthreads)
+{
+  // Scan nscan points of the L curve to choose tau (default 30).
+  // With nthreads>1, the points are evenly spaced in log10(tau) and unfolded
+  // on nthreads threads, instead of being placed by TUnfold::ScanLcurve.
+  _nScan= nscan>3 ? nscan : 3;
+  _nthreadsScan= nthreads;
+  _fastScan= false;
+}
+
+void
+RooUnfoldTUnfold::SetFastScan (Bool_t fast)
+{
+  // Choose tau with a coarse-to-fine search for the L-curve kink rather than the full scan
+  _fastScan= fast;
 }
 
 void
@@ -42,6 +42,10 @@ public:
   TUnfold* Impl();
   void FixTau(Double_t tau);
   void OptimiseTau();
+  void SetTauScan (Int_t nscan, Int_t nthreads= 1);  // full L-curve scan: number of points and threads
+  void SetFastScan (Bool_t fast= kTRUE);              // coarse-to-fine search for the L-curve kink
+  Int_t  GetNScan() const;
+  Bool_t GetFastScan() const;
   virtual void SetRegParm(Double_t parm);
   Double_t GetTau() const;
   const TGraph*  GetLCurve()  const;
@@ -59,19 +63,34 @@ protected:
   virtual void GetSettings();
   void Assign   (const RooUnfoldTUnfold& rhs); // implementation of assignment operator
   void CopyData (const RooUnfoldTUnfold& rhs);
+  virtual void SetupToy (RooUnfold* toy) const;
+  TUnfold* MakeTUnfold (const TH2D* Hres, Bool_t sys= kFALSE) const;
+  void ScanLcurveFast();
+  void ScanLcurveParallel (const TH2D* Hres, const TH1D* meas);
+  void SaveLcurve (Int_t n, const Double_t* logTau, const Double_t* x, const Double_t* y);
 
 private:
+  struct ScanJob;
+  static void ScanTask (Int_t itask, void* arg);
+  Bool_t TauRange (Double_t& logTauMin, Double_t& logTauMax);
+  static Double_t Curvature (const Double_t* t, const Double_t* x, const Double_t* y);
+
+
   TUnfold::ERegMode _reg_method; //Regularisation method
   TUnfold* _unf; //! Implementation in TUnfold object (no streamer)
   Bool_t tau_set;
   Double_t _tau;
+  Int_t _nScan;      // number of points for the full L-curve scan
+  Bool_t _fastScan;  // coarse-to-fine search instead of the full scan
+  Int_t _nthreadsScan; //! number of threads for the full L-curve scan
+  Bool_t _tauScanned;  //! _tau was chosen by the L-curve scan (toys reuse it)
   TSpline* _logTauX;
   TSpline* _logTauY;
   TGraph*  _lCurve;
 
 public:
 
-  ClassDef (RooUnfoldTUnfold, 1)   // Interface to TUnfold
+  ClassDef (RooUnfoldTUnfold, 2)   // Interface to TUnfold
 };
 
 // Inline method definitions
@@ -136,6 +155,20 @@ Double_t RooUnfoldTUnfold::GetRegParm() const
   return _tau;
 }
 
+inline
+Int_t RooUnfoldTUnfold::GetNScan() const
+{
+  // Number of points for the full L-curve scan
+  return _nScan;
+}
+
+inline
+Bool_t RooUnfoldTUnfold::GetFastScan() const
+{
+  // Whether the L-curve kink is found with the coarse-to-fine search
+  return _fastScan;
+}
+
 inline
 TUnfold::ERegMode RooUnfoldTUnfold::GetRegMethod() const
 {
@@ -12,12 +12,11 @@
 #pragma link C++ class RooUnfoldErrors+;
 #pragma link C++ class RooUnfoldParms+;
 #pragma link C++ class RooUnfoldInvert+;
+#pragma link C++ class RooUnfoldParallel;
 #ifndef NOTUNFOLD
 #pragma link C++ class RooUnfoldTUnfold+;
 #endif
-#ifdef HAVE_DAGOSTINI
 #pragma link C++ class RooUnfoldDagostini+;
-#endif
 //#pragma link C++ class TSVDUnfold_130729+;
 
 #endif
@@ -52,7 +52,18 @@ TH1D* unfresult = tsvdunf->Unfold( kreg );
 </ul>
 where <tt>kreg</tt> determines the regularisation of the unfolding. In general, overregularisation (too small <tt>kreg</tt>) will bias the unfolded spectrum towards the Monte Carlo input, while underregularisation (too large <tt>kreg</tt>) will lead to large fluctuations in the unfolded spectrum. The optimal regularisation can be determined following guidelines in <a href="http://arXiv.org/abs/hep-ph/9509307">Nucl. Instrum. Meth. A372, 469 (1996) [hep-ph/9509307]</a> using the distribution of the <tt>|d_i|<\tt> that can be obtained by <tt>tsvdunf->GetD()</tt> and/or using pseudo-experiments.
 <p>
-Covariance matrices on the measured spectrum (for either the total uncertainties or individual sources of uncertainties) can be propagated to covariance matrices using the <tt>GetUnfoldCovMatrix</tt> method, which uses pseudo experiments for the propagation. In addition, <tt>GetAdetCovMatrix</tt> allows for the propagation of the statistical uncertainties on the response matrix using pseudo experiments. The covariance matrix corresponding to <tt>Bcov</tt> is also computed as described in <a href="http://arXiv.org/abs/hep-ph/9509307">Nucl. Instrum. Meth. A372, 469 (1996) [hep-ph/9509307]</a> and can be obtained from <tt>tsvdunf->GetXtau()</tt> and its (regularisation independent) inverse from  <tt>tsvdunf->GetXinv()</tt>. The distribution of singular values can be retrieved using <tt>tsvdunf->GetSV()</tt>.
+The decomposition of the problem does not depend on <tt>kreg</tt>, so several regularisations can be obtained at once (and much faster than with one <tt>Unfold(kreg)</tt> call each) by
+<ul>
+<pre>
+Int_t kregs[3] = { 6, 7, 8 };
+TH1D* unfresults[3];
+TH2D* xtaus[3];
+tsvdunf->Unfold( 3, kregs, unfresults, xtaus );
+</pre>
+</ul>
+The decomposition is also kept between calls, e.g. for the pseudo experiments of <tt>GetUnfoldCovMatrix</tt>.
+<p>
+Covariance matrices on the measured spectrum (for either the total uncertainties or individual sources of uncertainties) can be propagated to covariance matrices using the <tt>GetUnfoldCovMatrix</tt> method, which uses pseudo experiments for the propagation. In addition, <tt>GetAdetCovMatrix</tt> allows for the propagation of the statistical uncertainties on the response matrix using pseudo experiments. The covariance matrix corresponding to <tt>Bcov</tt> is also computed as described in <a href="http://arXiv.org/abs/hep-ph/9509307">Nucl. Instrum. Meth. A372, 469 (1996) [hep-ph/9509307]</a> and can be obtained from <tt>tsvdunf->GetXtau()</tt> and its (regularisation independent) inverse from  <tt>tsvdunf->GetXinv()</tt>. The distribution of singular values can be retrieved using <tt>tsvdunf->GetSV()</tt>. The pseudo experiments of <tt>GetAdetCovMatrix</tt> can be run on several threads with <tt>tsvdunf->SetNThreads( n )</tt>; each pseudo experiment then uses its own random stream derived from the seed, so the result does not depend on the number of threads.
 <p>
 See also the tutorial for a toy example.
 End_Html */
@@ -60,6 +71,7 @@ End_Html */
 
 
 #include <iostream>
+#include <vector>
 
 #include "TSVDUnfold_local.h"
 #include "TH1D.h"
@@ -68,10 +80,32 @@ End_Html */
 #include "TRandom3.h"
 #include "TMath.h"
 
+#include "RooUnfoldParallel.h"
+
 ClassImp(TSVDUnfold)
 
 using namespace std;
 
+namespace {
+
+   const Int_t NAdetBlock = 4;  // response matrix toys per task: fixed, so the sums don't depend on the number of threads
+
+}
+
+//_______________________________________________________________________
+struct TSVDUnfold::AdetToyJob {
+   const TSVDUnfold*   svd;
+   const TMatrixD*     adet;
+   const TMatrixD*     unc;     // 0 = Poisson variations
+   const TVectorD*     vbrot;
+   Int_t               kreg;
+   Int_t               ntoys;
+   UInt_t              seed;
+   vector<Int_t>       n;       // running statistics for each block of toys
+   vector<TVectorD>    mean;
+   vector<TMatrixDSym> comom;
+};
+
 //_______________________________________________________________________
 TSVDUnfold::TSVDUnfold( const TH1D *bdat, const TH1D *bini, const TH1D *xini, const TH2D *Adet )
   : TObject     (),
@@ -90,7 +124,10 @@ TSVDUnfold::TSVDUnfold( const TH1D *bdat, const TH1D *bini, const TH1D *xini, co
     fToyhisto   (NULL),
     fToymat     (NULL),
     fToyMode    (kFALSE),
-    fMatToyMode (kFALSE)
+    fMatToyMode (kFALSE),
+    fHaveCB     (kFALSE),
+    fHaveA      (kFALSE),
+    fNThreads   (0)
 {
   // Alternative constructor
   // User provides data and MC test spectra, as well as detector response matrix, diagonal covariance matrix of measured spectrum built from the uncertainties on measured spectrum
@@ -142,7 +179,10 @@ TSVDUnfold::TSVDUnfold( const TH1D *bdat, TH2D* Bcov, const TH1D *bini, const TH
      fToyhisto   (NULL),
      fToymat     (NULL),
      fToyMode    (kFALSE),
-     fMatToyMode (kFALSE) 
+     fMatToyMode (kFALSE),
+     fHaveCB     (kFALSE),
+     fHaveA      (kFALSE),
+    fNThreads   (0)
 {
    // Default constructor
    // Initialisation of TSVDUnfold
@@ -188,7 +228,21 @@ TSVDUnfold::TSVDUnfold( const TSVDUnfold& other )
      fToyhisto   (other.fToyhisto),
      fToymat     (other.fToymat),
      fToyMode    (other.fToyMode),
-     fMatToyMode (other.fMatToyMode) 
+     fMatToyMode (other.fMatToyMode),
+     fHaveCB     (other.fHaveCB),
+     fHaveA      (other.fHaveA),
+     fNThreads   (other.fNThreads),
+     fCurv       (other.fCurv),
+     fCinv       (other.fCinv),
+     fQT         (other.fQT),
+     fBSV        (other.fBSV),
+     fVxini      (other.fVxini),
+     fArot       (other.fArot),
+     fUortT      (other.fUortT),
+     fVort       (other.fVort),
+     fVreg       (other.fVreg),
+     fASV        (other.fASV),
+     fXinv0      (other.fXinv0)
 {
    // Copy constructor
 }
@@ -237,152 +291,214 @@ TSVDUnfold::~TSVDUnfold()
 TH1D* TSVDUnfold::Unfold( Int_t kreg )
 {
    // Perform the unfolding with regularisation parameter kreg
-   fKReg = kreg;
-   
+   TH1D* h = 0;
+   Unfold( 1, &kreg, &h );
+   return h;
+}
+
+//_______________________________________________________________________
+void TSVDUnfold::Unfold( Int_t nk, const Int_t* kreg, TH1D** unf, TH2D** xtau )
+{
+   // Perform the unfolding for each of the nk regularisation parameters kreg[0..nk-1].
+   // Only the damping factors depend on kreg, so the decompositions are done once (and
+   // kept for later calls, e.g. toys of the measured spectrum).
+   // GetD() and GetSV() do not depend on kreg; GetKReg(), GetXtau() and GetXinv()
+   // correspond to the last kreg.
+
    // Make the histos
    if (!fToyMode && !fMatToyMode) InitHistos( );
 
-   // Create vectors and matrices
-   TVectorD vb(fNdim), vbini(fNdim), vxini(fNdim), vberr(fNdim);
-   TMatrixD mB(fNdim, fNdim), mA(fNdim, fNdim), mCurv(fNdim, fNdim), mC(fNdim, fNdim);
+   Decompose( );
 
-   Double_t eps = 1e-12;
-   Double_t sreg;
+   // Copy histogam entries into vector
+   TVectorD vb(fNdim);
+   if (fToyMode) H2V( fToyhisto, vb );
+   else          H2V( fBdat,     vb );
+
+   //Rescale using the data covariance matrix
+   TVectorD vbtmp(fNdim);
+   vbtmp *= 0;
+   for(int i=0; i<fNdim; i++){
+     for(int j=0; j<fNdim; j++){
+       if(fBSV(i)){
+  	 vbtmp(i) += fQT(i,j)*vb(j)/fBSV(i);
+       }
+     }
+   }
 
-   // Copy histogams entries into vector
-   if (fToyMode) { H2V( fToyhisto, vb ); H2Verr( fToyhisto, vberr ); }
-   else          { H2V( fBdat,     vb ); H2Verr( fBdat,     vberr ); }
+   TVectorD vd = fUortT*vbtmp;
 
-   H2M( fBcov, mB);
-   H2V( fBini, vbini );
-   H2V( fXini, vxini );
-   if (fMatToyMode) H2M( fToymat, mA );
-   else        H2M( fAdet,   mA );
+   if (!fToyMode && !fMatToyMode) {
+      V2H(fASV, *fSVHist);
+      V2H(vd, *fDHist);
+   }
 
-   // Fill and invert the second derivative matrix
-   FillCurvatureMatrix( mCurv, mC );
+   for (Int_t ik=0; ik<nk; ik++) {
+      TH2D* cov = 0;
+      if (xtau) {
+         cov = (TH2D*)fAdet->Clone("Xtau");
+         cov->SetTitle("Regularized covariance matrix");
+         xtau[ik] = cov;
+      }
+      unf[ik] = Solve( kreg[ik], vd, cov );
+   }
+}
 
-   // Inversion of mC by help of SVD
-   TDecompSVD CSVD(mC);
-   TMatrixD CUort = CSVD.GetU();
-   TMatrixD CVort = CSVD.GetV();
-   TVectorD CSV   = CSVD.GetSig();
+//_______________________________________________________________________
+void TSVDUnfold::Decompose( )
+{
+   // Decompositions which depend neither on kreg nor on the measured spectrum.
+   // The response part is redone for every call in response matrix toy mode.
+
+   if (!fHaveCB) {
+      TMatrixD mC(fNdim, fNdim);
+      fCurv.ResizeTo(fNdim, fNdim);
+
+      // Fill and invert the second derivative matrix
+      FillCurvatureMatrix( fCurv, mC );
+
+      // Inversion of mC by help of SVD
+      TDecompSVD CSVD(mC);
+      TMatrixD CUort = CSVD.GetU();
+      TMatrixD CVort = CSVD.GetV();
+      TVectorD CSV   = CSVD.GetSig();
+
+      TMatrixD CSVM(fNdim, fNdim);
+      for (Int_t i=0; i<fNdim; i++) CSVM(i,i) = 1/CSV(i);
+
+      CUort.Transpose( CUort );
+      fCinv.ResizeTo(fNdim, fNdim);
+      fCinv = (CVort*CSVM)*CUort;
+
+      // Decompose the data covariance matrix
+      TMatrixD mB(fNdim, fNdim);
+      H2M( fBcov, mB );
+      TDecompSVD BSVD( mB );
+      fQT.ResizeTo(fNdim, fNdim);
+      fQT = BSVD.GetU();
+      fQT.Transpose(fQT);
+      TVectorD B2SV = BSVD.GetSig();
+
+      fBSV.ResizeTo(fNdim);
+      for(int i=0; i<fNdim; i++){
+        fBSV(i) = TMath::Sqrt(B2SV(i));
+      }
 
-   TMatrixD CSVM(fNdim, fNdim);
-   for (Int_t i=0; i<fNdim; i++) CSVM(i,i) = 1/CSV(i);
+      fVxini.ResizeTo(fNdim);
+      H2V( fXini, fVxini );
+      fHaveCB = kTRUE;
+   }
 
-   CUort.Transpose( CUort );
-   TMatrixD mCinv = (CVort*CSVM)*CUort;
+   if (fHaveA && !fMatToyMode) return;
 
-   //Rescale using the data covariance matrix
-   TDecompSVD BSVD( mB );
-   TMatrixD QT = BSVD.GetU();
-   QT.Transpose(QT);
-   TVectorD B2SV = BSVD.GetSig();
-   TVectorD BSV(B2SV);
+   TMatrixD mA(fNdim, fNdim);
+   if (fMatToyMode) H2M( fToymat, mA );
+   else             H2M( fAdet,   mA );
 
-   for(int i=0; i<fNdim; i++){
-     BSV(i) = TMath::Sqrt(B2SV(i));
-   }
-   TMatrixD mAtmp(fNdim,fNdim);
-   TVectorD vbtmp(fNdim);
-   mAtmp *= 0;
-   vbtmp *= 0;
+   //Rescale using the data covariance matrix
+   fArot.ResizeTo(fNdim, fNdim);
+   fArot *= 0;
    for(int i=0; i<fNdim; i++){
      for(int j=0; j<fNdim; j++){
-       if(BSV(i)){
-  	 vbtmp(i) += QT(i,j)*vb(j)/BSV(i);
-       }
        for(int m=0; m<fNdim; m++){
- 	 if(BSV(i)){
- 	   mAtmp(i,j) += QT(i,m)*mA(m,j)/BSV(i);
+ 	 if(fBSV(i)){
+ 	   fArot(i,j) += fQT(i,m)*mA(m,j)/fBSV(i);
  	 }
        }
      }
    }
-   mA = mAtmp;
-   vb = vbtmp;
 
    // Singular value decomposition and matrix operations
-   TDecompSVD ASVD( mA*mCinv );
-   TMatrixD Uort = ASVD.GetU();
-   TMatrixD Vort = ASVD.GetV();
-   TVectorD ASV  = ASVD.GetSig();
-
-   if (!fToyMode && !fMatToyMode) {
-      V2H(ASV, *fSVHist);
+   TDecompSVD ASVD( fArot*fCinv );
+   fUortT.ResizeTo(fNdim, fNdim);
+   fVort.ResizeTo(fNdim, fNdim);
+   fASV.ResizeTo(fNdim);
+   fUortT = ASVD.GetU();
+   fVort  = ASVD.GetV();
+   fASV   = ASVD.GetSig();
+   fUortT.Transpose(fUortT);
+
+   fVreg.ResizeTo(fNdim, fNdim);
+   fVreg = fCinv*fVort;
+
+   // Inverse covariance matrix (only needed outside toy mode)
+   fXinv0.ResizeTo(fNdim, fNdim);
+   fXinv0 *= 0;
+   if (!fMatToyMode) {
+     for (Int_t i=0; i<fNdim; i++) {
+       for (Int_t j=0; j<fNdim; j++) {
+         double a=0;
+         for (Int_t m=0; m<fNdim; m++) {
+           a += fArot(m,i)*fArot(m,j);
+         }
+         if(fVxini(i)*fVxini(j))
+           fXinv0(i,j) = a/fVxini(i)/fVxini(j);
+       }
+     }
    }
 
-   TMatrixD Vreg = mCinv*Vort;
-
-   Uort.Transpose(Uort);
-   TVectorD vd    = Uort*vb;
+   fHaveA = !fMatToyMode;
+}
 
-   if (!fToyMode && !fMatToyMode) {
-      V2H(vd, *fDHist);
-   }
+//_______________________________________________________________________
+TH1D* TSVDUnfold::Solve( Int_t kreg, const TVectorD& vd, TH2D* xtau )
+{
+   // Unfolded spectrum for regularisation parameter kreg from the decomposition and
+   // the rotated measured spectrum vd. Fills xtau with the regularized covariance if given.
+   fKReg = kreg;
 
    // Damping coefficient
    Int_t k = GetKReg()-1; 
 
-   TVectorD vx(fNdim); // Return variable
-
    // Damping factors
-   TVectorD vdz(fNdim);
-   TMatrixD Z(fNdim, fNdim);
-   for (Int_t i=0; i<fNdim; i++) {
-     if (ASV(i)<ASV(0)*eps) sreg = ASV(0)*eps;
-     else                   sreg = ASV(i);
-     vdz(i) = sreg/(sreg*sreg + ASV(k)*ASV(k));
-     Z(i,i) = vdz(i)*vdz(i);
-   }
+   TVectorD vdz = DampingFactors( fASV, kreg );
    TVectorD vz = CompProd( vd, vdz );
-   
-   TMatrixD VortT(Vort);
-   VortT.Transpose(VortT);
-   TMatrixD W = mCinv*Vort*Z*VortT*mCinv;
-
-   TMatrixD Xtau(fNdim, fNdim);
-   TMatrixD Xinv(fNdim, fNdim);
-   Xtau *= 0;
-   Xinv *= 0;
-   for (Int_t i=0; i<fNdim; i++) {
-     for (Int_t j=0; j<fNdim; j++) {
-       Xtau(i,j) =  vxini(i) * vxini(j) * W(i,j);
-
-       double a=0;
-       for (Int_t m=0; m<fNdim; m++) {
-         a += mA(m,i)*mA(m,j);
-       }
-       if(vxini(i)*vxini(j))
-         Xinv(i,j) = a/vxini(i)/vxini(j);
-     }
-   }
 
    // Compute the weights
-   TVectorD vw = Vreg*vz;
+   TVectorD vw = fVreg*vz;
 
    // Rescale by xini
-   vx = CompProd( vw, vxini );
-   
+   TVectorD vx = CompProd( vw, fVxini );
+
+   Double_t scale = 0;
    if(fNormalize){ // Scale result to unit area
-     Double_t scale = vx.Sum();
-     if (scale > 0){
-       vx *= 1.0/scale;
+     scale = vx.Sum();
+     if (scale > 0) vx *= 1.0/scale;
+   }
+
+   // Covariance matrices (not needed for toys)
+   Bool_t fillHistos = (!fToyMode && !fMatToyMode);
+   if (fillHistos || xtau) {
+     TMatrixD Z(fNdim, fNdim);
+     for (Int_t i=0; i<fNdim; i++) Z(i,i) = vdz(i)*vdz(i);
+
+     TMatrixD VortT(fVort);
+     VortT.Transpose(VortT);
+     TMatrixD W = fVreg*Z*VortT*fCinv;
+
+     TMatrixD Xtau(fNdim, fNdim);
+     for (Int_t i=0; i<fNdim; i++) {
+       for (Int_t j=0; j<fNdim; j++) {
+         Xtau(i,j) =  fVxini(i) * fVxini(j) * W(i,j);
+       }
+     }
+     TMatrixD Xinv(fXinv0);
+     if (fNormalize && scale > 0) {
        Xtau *= 1./scale/scale;
        Xinv *= scale*scale;
      }
-   }
 
-   if (!fToyMode && !fMatToyMode) {
-      M2H(Xtau, *fXtau);
-      M2H(Xinv, *fXinv);
+     if (fillHistos) {
+       M2H(Xtau, *fXtau);
+       M2H(Xinv, *fXinv);
+     }
+     if (xtau) M2H(Xtau, *xtau);
    }
-   
+
    // Get Curvature and also chi2 in case of MC unfolding
-   if (!fToyMode && !fMatToyMode) {
+   if (fillHistos) {
      Info( "Unfold", "Unfolding param: %i",k+1 );
-     Info( "Unfold", "Curvature of weight distribution: %f", GetCurvature( vw, mCurv ) );
+     Info( "Unfold", "Curvature of weight distribution: %f", GetCurvature( vw, fCurv ) );
    }
 
    TH1D* h = (TH1D*)fBdat->Clone("unfoldingresult");
@@ -395,6 +511,58 @@ TH1D* TSVDUnfold::Unfold( Int_t kreg )
    return h;
 }
 
+//_______________________________________________________________________
+TVectorD TSVDUnfold::DampingFactors( const TVectorD& sv, Int_t kreg )
+{
+   // Damping factors of the rotated spectrum for singular values sv and regularisation parameter kreg
+   Double_t eps = 1e-12;
+   Double_t sreg;
+
+   Int_t k = kreg-1;
+   Int_t n = sv.GetNrows();
+   TVectorD vdz(n);
+   for (Int_t i=0; i<n; i++) {
+     if (sv(i)<sv(0)*eps) sreg = sv(0)*eps;
+     else                 sreg = sv(i);
+     vdz(i) = sreg/(sreg*sreg + sv(k)*sv(k));
+   }
+   return vdz;
+}
+
+//_______________________________________________________________________
+Bool_t TSVDUnfold::GetUnfoldMatrix( Int_t kreg, TMatrixD& mat )
+{
+   // Linear map from the measured to the unfolded spectrum for regularisation parameter kreg,
+   // i.e. Unfold(kreg) = mat * bdat (so the covariance of the unfolded spectrum is mat * Bcov * mat^T).
+   // Not available if the result is normalised (SetNormalize(kTRUE)).
+   if (fNormalize) return kFALSE;
+
+   Bool_t matToyMode = fMatToyMode;
+   fMatToyMode = kFALSE;
+   Decompose( );
+   fMatToyMode = matToyMode;
+
+   // diag(xini) * Vreg * diag(vdz) * UortT * diag(1/BSV) * QT
+   TVectorD vdz = DampingFactors( fASV, kreg );
+   TMatrixD mX(fVreg);
+   for (Int_t i=0; i<fNdim; i++) {
+     for (Int_t l=0; l<fNdim; l++) {
+       mX(i,l) *= fVxini(i)*vdz(l);
+     }
+   }
+   TMatrixD mB(fNdim, fNdim);
+   for (Int_t i=0; i<fNdim; i++) {
+     if (!fBSV(i)) continue;
+     for (Int_t j=0; j<fNdim; j++) {
+       mB(i,j) = fQT(i,j)/fBSV(i);
+     }
+   }
+
+   mat.ResizeTo(fNdim, fNdim);
+   mat = mX*fUortT*mB;
+   return kTRUE;
+}
+
 //_______________________________________________________________________
 TH2D* TSVDUnfold::GetUnfoldCovMatrix( const TH2D* cov, Int_t ntoys, Int_t seed )
 {
@@ -405,14 +573,9 @@ TH2D* TSVDUnfold::GetUnfoldCovMatrix( const TH2D* cov, Int_t ntoys, Int_t seed )
    // "seed"   - seed for pseudo experiments
    // Note that this covariance matrix will contain effects of forced normalisation if spectrum is normalised to unit area. 
 
-   fToyMode = true;
-   TH1D* unfres = 0;
    TH2D* unfcov = (TH2D*)fAdet->Clone("unfcovmat");
    unfcov->SetTitle("Toy covariance matrix");
-   for(int i=1; i<=fNdim; i++)
-      for(int j=1; j<=fNdim; j++)
-         unfcov->SetBinContent(i,j,0.);
-  
+
    // Code for generation of toys (taken from RooResult and modified)
    // Calculate the elements of the upper-triangular matrix L that
    // gives Lt*L = C, where Lt is the transpose of L (the "square-root method")  
@@ -439,11 +602,17 @@ TH2D* TSVDUnfold::GetUnfoldCovMatrix( const TH2D* cov, Int_t ntoys, Int_t seed )
    TMatrixD *Lt = new TMatrixD(TMatrixD::kTransposed,L);
    TRandom3 random(seed);
 
-   fToyhisto = (TH1D*)fBdat->Clone("toyhisto");
-   TH1D *toymean = (TH1D*)fBdat->Clone("toymean");
-   for (Int_t j=1; j<=fNdim; j++) toymean->SetBinContent(j,0.);
-
-   // Get the mean of the toys first
+   // Only the measured spectrum changes, so each toy is solved with the cached
+   // decomposition and damping factors, without any histograms
+   Decompose( );
+   TVectorD vdz = DampingFactors( fASV, GetKReg() );
+   TVectorD vbdat(fNdim);
+   H2V( fBdat, vbdat );
+
+   // Mean and covariance in one pass over the toys (running mean and co-moments)
+   Int_t       n = 0;
+   TVectorD    toymean(fNdim);
+   TMatrixDSym toycov(fNdim);
    for (int i=1; i<=ntoys; i++) {
 
       // create a vector of unit Gaussian variables
@@ -453,56 +622,47 @@ TH2D* TSVDUnfold::GetUnfoldCovMatrix( const TH2D* cov, Int_t ntoys, Int_t seed )
       // Multiply this vector by Lt to introduce the appropriate correlations
       g *= (*Lt);
 
-      // Add the mean value offsets and store the results
-      for (int j=1; j<=fNdim; j++) {
-         fToyhisto->SetBinContent(j,fBdat->GetBinContent(j)+g(j-1));
-         fToyhisto->SetBinError(j,fBdat->GetBinError(j));
-      }
-
-      unfres = Unfold(GetKReg());
-
-      for (Int_t j=1; j<=fNdim; j++) {
-         toymean->SetBinContent(j, toymean->GetBinContent(j) + unfres->GetBinContent(j)/ntoys);
-      }
-      delete unfres;
-      unfres = 0;
+      // Add the mean value offsets and unfold
+      g += vbdat;
+      AddToy( n, toymean, toycov, SolveToy( RotateData( g ), vdz ) );
    }
+   delete Lt;
 
-   // Reset the random seed
-   random.SetSeed(seed);
-
-   //Now the toys for the covariance matrix
-   for (int i=1; i<=ntoys; i++) {
-
-      // Create a vector of unit Gaussian variables
-      TVectorD g(fNdim);
-      for (Int_t k= 0; k < fNdim; k++) g(k) = random.Gaus(0.,1.);
-
-      // Multiply this vector by Lt to introduce the appropriate correlations
-      g *= (*Lt);
-
-      // Add the mean value offsets and store the results
-      for (int j=1; j<=fNdim; j++) {
-         fToyhisto->SetBinContent( j, fBdat->GetBinContent(j)+g(j-1) );
-         fToyhisto->SetBinError  ( j, fBdat->GetBinError(j) );
-      }
-      unfres = Unfold(GetKReg());
-
-      for (Int_t j=1; j<=fNdim; j++) {
-         for (Int_t k=1; k<=fNdim; k++) {
-            unfcov->SetBinContent(j,k,unfcov->GetBinContent(j,k) + ( (unfres->GetBinContent(j) - toymean->GetBinContent(j))* (unfres->GetBinContent(k) - toymean->GetBinContent(k))/(ntoys-1)) );
-         }
-      }
-      delete unfres;
-      unfres = 0;
+   if (ntoys > 1) toycov *= 1./(ntoys-1);
+   for (Int_t j=0; j<fNdim; j++) {
+      for (Int_t k=0; k<fNdim; k++) unfcov->SetBinContent(j+1,k+1,toycov(j,k));
    }
-   delete Lt;
-   delete toymean;
-   fToyMode = kFALSE;
    
    return unfcov;
 }
 
+//_______________________________________________________________________
+TVectorD TSVDUnfold::RotateData( const TVectorD& vb ) const
+{
+   // Measured spectrum vb rescaled with the (cached) data covariance matrix
+   TVectorD vbtmp(fNdim);
+   for (Int_t i=0; i<fNdim; i++) {
+     if (!fBSV(i)) continue;
+     for (Int_t j=0; j<fNdim; j++) vbtmp(i) += fQT(i,j)*vb(j)/fBSV(i);
+   }
+   return vbtmp;
+}
+
+//_______________________________________________________________________
+TVectorD TSVDUnfold::SolveToy( const TVectorD& vbrot, const TVectorD& vdz ) const
+{
+   // Unfolded spectrum for the rescaled measured spectrum vbrot (see RotateData) from the
+   // cached decomposition and the damping factors vdz, without histograms or covariance matrices
+   TVectorD vd = fUortT*vbrot;
+   TVectorD vw = fVreg*CompProd( vd, vdz );
+   TVectorD vx = CompProd( vw, fVxini );
+   if (fNormalize) {
+     Double_t scale = vx.Sum();
+     if (scale > 0) vx *= 1.0/scale;
+   }
+   return vx;
+}
+
 //_______________________________________________________________________
 TH2D* TSVDUnfold::GetAdetCovMatrix( Int_t ntoys, Int_t seed, const TH2D* uncmat )
 {
@@ -521,75 +681,174 @@ TH2D* TSVDUnfold::GetAdetCovMatrix( Int_t ntoys, Int_t seed, const TH2D* uncmat
     }
 
 
-   fMatToyMode = true;
-   TH1D* unfres = 0;
    TH2D* unfcov = (TH2D*)fAdet->Clone("unfcovmat");
    unfcov->SetTitle("Toy covariance matrix");
-   for(int i=1; i<=fNdim; i++)
-      for(int j=1; j<=fNdim; j++)
-         unfcov->SetBinContent(i,j,0.);
 
-   //Now the toys for the detector response matrix
-   TRandom3 random(seed);
+   // Only the response matrix changes: the curvature and data covariance parts of the
+   // decomposition, and the rescaled measured spectrum, are the same for every toy
+   Decompose( );
+   TVectorD vbdat(fNdim);
+   H2V( fBdat, vbdat );
+   TVectorD vbrot = RotateData( vbdat );
+
+   // Response matrix and its uncertainties (none: Poisson variations)
+   TMatrixD adet(fNdim, fNdim);
+   H2M( fAdet, adet );
+   TMatrixD unc;
+   if (uncmat) {
+      unc.ResizeTo(fNdim, fNdim);
+      H2M( uncmat, unc );
+   }
+   else if (fAdet->GetSumw2N()) {
+      unc.ResizeTo(fNdim, fNdim);
+      for (Int_t k=0; k<fNdim; k++)
+         for (Int_t m=0; m<fNdim; m++) unc(k,m) = fAdet->GetBinError(k+1,m+1);
+   }
 
-   fToymat = (TH2D*)fAdet->Clone("toymat");
-   TH1D *toymean = (TH1D*)fXini->Clone("toymean");
-   for (Int_t j=1; j<=fNdim; j++) toymean->SetBinContent(j,0.);
-
-   for (int i=1; i<=ntoys; i++) {    
-      for (Int_t k=1; k<=fNdim; k++) {
-         for (Int_t m=1; m<=fNdim; m++) {
-	   if (fAdet->GetBinContent(k,m)){
-	     if(uncmat)
-	       fToymat->SetBinContent(k, m, fAdet->GetBinContent(k,m)+random.Gaus(0.,uncmat->GetBinContent(k,m)));
-	     else if(fAdet->GetSumw2N())
-	       fToymat->SetBinContent(k, m, fAdet->GetBinContent(k,m)+random.Gaus(0.,fAdet->GetBinError(k,m)));
-	     else 
-	       fToymat->SetBinContent(k, m, random.Poisson(fAdet->GetBinContent(k,m)));
-	   }
+   AdetToyJob job;
+   job.svd   = this;
+   job.adet  = &adet;
+   job.unc   = unc.GetNrows() ? &unc : 0;
+   job.vbrot = &vbrot;
+   job.kreg  = GetKReg();
+   job.ntoys = ntoys;
+   job.seed  = seed;
+
+   Int_t       n = 0;
+   TVectorD    toymean(fNdim);
+   TMatrixDSym toycov(fNdim);
+   if (fNThreads > 1 || fNThreads < 0) {
+
+      // Blocks of toys on several threads, each toy with its own random stream
+      Int_t nblock = (ntoys + NAdetBlock - 1) / NAdetBlock;
+      job.n    .assign( nblock, 0 );
+      job.mean .assign( nblock, TVectorD(fNdim) );
+      job.comom.assign( nblock, TMatrixDSym(fNdim) );
+      RooUnfoldParallel::Run( nblock, AdetToyTask, &job, fNThreads > 1 ? fNThreads : 1 );
+
+      // Pairwise reduction in a fixed order
+      for (Int_t step=1; step<nblock; step *= 2) {
+         for (Int_t b=0; b+step<nblock; b += 2*step) {
+            MergeToys( job.n[b], job.mean[b], job.comom[b], job.n[b+step], job.mean[b+step], job.comom[b+step] );
          }
       }
+      if (nblock > 0) {
+         n       = job.n[0];
+         toymean = job.mean[0];
+         toycov  = job.comom[0];
+      }
+   }
+   else {
+
+      // All toys from one random stream (as the original implementation)
+      TRandom3 random(seed);
+      TMatrixD toymat(adet);
+      for (int i=1; i<=ntoys; i++) {
+         SmearResponse( random, adet, job.unc, toymat );
+         AddToy( n, toymean, toycov, SolveMatToy( toymat, vbrot, job.kreg ) );
+      }
+   }
+
+   if (n > 1) toycov *= 1./(n-1);
+   for (Int_t j=0; j<fNdim; j++) {
+      for (Int_t k=0; k<fNdim; k++) unfcov->SetBinContent(j+1,k+1,toycov(j,k));
+   }
+   
+   return unfcov;
+}
 
-      unfres = Unfold(GetKReg());
+//_______________________________________________________________________
+void TSVDUnfold::AdetToyTask( Int_t iblock, void* arg )
+{
+   // Run one block of response matrix toys. The toy matrix is allocated once per
+   // block and only its non-zero elements are overwritten for each toy.
+   AdetToyJob* job = (AdetToyJob*)arg;
+   TMatrixD toymat(*job->adet);
+   TRandom3 random;
+   Int_t kmax = (iblock+1)*NAdetBlock;
+   if (kmax > job->ntoys) kmax = job->ntoys;
+   for (Int_t k=iblock*NAdetBlock; k<kmax; k++) {
+      random.SetSeed( RooUnfoldParallel::Seed( job->seed, k ) );
+      SmearResponse( random, *job->adet, job->unc, toymat );
+      AddToy( job->n[iblock], job->mean[iblock], job->comom[iblock], job->svd->SolveMatToy( toymat, *job->vbrot, job->kreg ) );
+   }
+}
 
-      for (Int_t j=1; j<=fNdim; j++) {
-         toymean->SetBinContent(j, toymean->GetBinContent(j) + unfres->GetBinContent(j)/ntoys);
+//_______________________________________________________________________
+void TSVDUnfold::SmearResponse( TRandom& random, const TMatrixD& adet, const TMatrixD* unc, TMatrixD& toymat )
+{
+   // Fill toymat with a variation of the non-zero elements of adet: Gaussian with
+   // uncertainties unc if given, Poisson otherwise
+   Int_t n = adet.GetNrows();
+   for (Int_t k=0; k<n; k++) {
+      for (Int_t m=0; m<n; m++) {
+         if (!adet(k,m)) continue;
+         if (unc) toymat(k,m) = adet(k,m)+random.Gaus(0.,(*unc)(k,m));
+         else     toymat(k,m) = random.Poisson(adet(k,m));
       }
-      delete unfres;
-      unfres = 0;
    }
+}
 
-   // Reset the random seed
-   random.SetSeed(seed);
+//_______________________________________________________________________
+TVectorD TSVDUnfold::SolveMatToy( const TMatrixD& mA, const TVectorD& vbrot, Int_t kreg ) const
+{
+   // Unfolded spectrum for the toy response matrix mA and the rescaled measured spectrum
+   // vbrot, reusing the cached curvature and data covariance parts of the decomposition
+   TMatrixD arot(fNdim, fNdim);
+   for (Int_t i=0; i<fNdim; i++) {
+     if (!fBSV(i)) continue;
+     for (Int_t j=0; j<fNdim; j++) {
+       for (Int_t m=0; m<fNdim; m++) arot(i,j) += fQT(i,m)*mA(m,j)/fBSV(i);
+     }
+   }
 
-   for (int i=1; i<=ntoys; i++) {
-      for (Int_t k=1; k<=fNdim; k++) {
-         for (Int_t m=1; m<=fNdim; m++) {
-	   if (fAdet->GetBinContent(k,m)){
-	     if(uncmat)
-	       fToymat->SetBinContent(k, m, fAdet->GetBinContent(k,m)+random.Gaus(0.,uncmat->GetBinContent(k,m)));
-	     else if(fAdet->GetSumw2N())
-	       fToymat->SetBinContent(k, m, fAdet->GetBinContent(k,m)+random.Gaus(0.,fAdet->GetBinError(k,m)));
-	     else 
-	       fToymat->SetBinContent(k, m, random.Poisson(fAdet->GetBinContent(k,m)));
-	   }
-         }
-      }
+   TDecompSVD ASVD( arot*fCinv );
+   TMatrixD uortT(TMatrixD::kTransposed, ASVD.GetU());
+   TMatrixD vreg = fCinv*ASVD.GetV();
+   TVectorD vdz  = DampingFactors( ASVD.GetSig(), kreg );
 
-      unfres = Unfold(GetKReg());
+   TVectorD vd = uortT*vbrot;
+   TVectorD vw = vreg*CompProd( vd, vdz );
+   TVectorD vx = CompProd( vw, fVxini );
+   if (fNormalize) {
+     Double_t scale = vx.Sum();
+     if (scale > 0) vx *= 1.0/scale;
+   }
+   return vx;
+}
 
-      for (Int_t j=1; j<=fNdim; j++) {
-         for (Int_t k=1; k<=fNdim; k++) {
-            unfcov->SetBinContent(j,k,unfcov->GetBinContent(j,k) + ( (unfres->GetBinContent(j) - toymean->GetBinContent(j))*(unfres->GetBinContent(k) - toymean->GetBinContent(k))/(ntoys-1)) );
-         }
-      }
-      delete unfres;
-      unfres = 0;
+//_______________________________________________________________________
+void TSVDUnfold::AddToy( Int_t& n, TVectorD& mean, TMatrixDSym& comom, const TVectorD& x )
+{
+   // Add toy result x to the running mean and co-moment matrix (covariance = comom/(n-1))
+   n++;
+   Int_t nd = x.GetNrows();
+   TVectorD delta(nd);
+   for (Int_t j=0; j<nd; j++) {
+      delta(j) = x(j) - mean(j);
+      mean(j) += delta(j)/n;
    }
-   delete toymean;
-   fMatToyMode = kFALSE;
-   
-   return unfcov;
+   for (Int_t j=0; j<nd; j++) {
+      Double_t dj = x(j) - mean(j);
+      for (Int_t k=0; k<nd; k++) comom(j,k) += delta(k)*dj;
+   }
+}
+
+//_______________________________________________________________________
+void TSVDUnfold::MergeToys( Int_t& n, TVectorD& mean, TMatrixDSym& comom,
+                            Int_t nb, const TVectorD& meanb, const TMatrixDSym& comomb )
+{
+   // Merge the running statistics of a second set of nb toys
+   if (nb <= 0) return;
+   Int_t ntot = n + nb;
+   Double_t f = Double_t(n)*nb/ntot;
+   Int_t nd = mean.GetNrows();
+   TVectorD delta = meanb - mean;
+   for (Int_t j=0; j<nd; j++) {
+      for (Int_t k=0; k<nd; k++) comom(j,k) += comomb(j,k) + f*delta(j)*delta(k);
+   }
+   for (Int_t j=0; j<nd; j++) mean(j) += delta(j)*nb/ntot;
+   n = ntot;
 }
 
 //_______________________________________________________________________
@@ -54,6 +54,7 @@
 
 class TH1D;
 class TH2D;
+class TRandom;
 
 class TSVDUnfold : public TObject {
 
@@ -81,6 +82,19 @@ public:
    // "kreg"   - number of singular values used (regularisation)
    TH1D*    Unfold       ( Int_t kreg );
 
+   // Do the unfolding for several regularisation parameters at once
+   // (the decomposition does not depend on kreg, so it is done only once)
+   // "nk"     - number of regularisation parameters
+   // "kreg"   - regularisation parameters
+   // "unf"    - returns the unfolded spectra (one per kreg, owned by the caller)
+   // "xtau"   - if given, returns the regularized covariance matrices (one per kreg, owned by the caller)
+   void     Unfold       ( Int_t nk, const Int_t* kreg, TH1D** unf, TH2D** xtau = 0 );
+
+   // Linear map from measured to unfolded spectrum (Unfold(kreg) = mat * bdat)
+   // "kreg"   - regularisation parameter
+   // "mat"    - returns the matrix; kFALSE if not available (normalised result)
+   Bool_t   GetUnfoldMatrix( Int_t kreg, TMatrixD& mat );
+
    // Determine for given input error matrix covariance matrix of unfolded 
    // spectrum from toy simulation
    // "cov"    - covariance matrix on the measured spectrum, to be propagated
@@ -88,6 +102,13 @@ public:
    // "seed"   - seed for pseudo experiments
    TH2D*    GetUnfoldCovMatrix( const TH2D* cov, Int_t ntoys, Int_t seed = 1 );
 
+   // Number of threads for the pseudo experiments of GetAdetCovMatrix
+   // "nthreads" - 0 or 1: serially, with one random stream (default); otherwise each
+   //              pseudo experiment gets its own stream derived from the seed
+   //              (negative: serially, but with one stream per pseudo experiment)
+   void     SetNThreads  ( Int_t nthreads ) { fNThreads = nthreads; }
+   Int_t    GetNThreads  ( ) const { return fNThreads; }
+
    // Determine covariance matrix of unfolded spectrum from finite statistics in 
    // response matrix
    // "ntoys"  - number of pseudo experiments used for the propagation
@@ -124,6 +145,22 @@ private:
 
    void            InitHistos  ( );
 
+   // Decomposition of the problem (independent of kreg) and solution for one kreg
+   void            Decompose   ( );
+   TH1D*           Solve       ( Int_t kreg, const TVectorD& vd, TH2D* xtau );
+   TVectorD        RotateData  ( const TVectorD& vb ) const;
+   TVectorD        SolveToy    ( const TVectorD& vbrot, const TVectorD& vdz ) const;
+   TVectorD        SolveMatToy ( const TMatrixD& mA, const TVectorD& vbrot, Int_t kreg ) const;
+   static TVectorD DampingFactors( const TVectorD& sv, Int_t kreg );
+
+   // Pseudo experiments
+   struct AdetToyJob;
+   static void     AdetToyTask  ( Int_t iblock, void* arg );
+   static void     SmearResponse( TRandom& random, const TMatrixD& adet, const TMatrixD* unc, TMatrixD& toymat );
+   static void     AddToy       ( Int_t& n, TVectorD& mean, TMatrixDSym& comom, const TVectorD& x );
+   static void     MergeToys    ( Int_t& n, TVectorD& mean, TMatrixDSym& comom,
+                                  Int_t nb, const TVectorD& meanb, const TMatrixDSym& comomb );
+
    // Helper functions
    static void     H2V      ( const TH1D* histo, TVectorD& vec   );
    static void     H2Verr   ( const TH1D* histo, TVectorD& vec   );
@@ -159,6 +196,22 @@ private:
    Bool_t      fToyMode;     //! Internal switch for covariance matrix propagation
    Bool_t      fMatToyMode;  //! Internal switch for evaluation of statistical uncertainties from response matrix
 
+   // Cached decomposition (reused for every kreg and for toys of the measured spectrum)
+   Bool_t      fHaveCB;      //! Curvature and data covariance parts are cached
+   Bool_t      fHaveA;       //! Response part is cached (not in response matrix toy mode)
+   TMatrixD    fCurv;        //! Curvature matrix
+   TMatrixD    fCinv;        //! Inverse of second derivative matrix
+   TMatrixD    fQT;          //! Transposed eigenvectors of data covariance matrix
+   TVectorD    fBSV;         //! Square roots of eigenvalues of data covariance matrix
+   TVectorD    fVxini;       //! Truth MC distribution
+   TMatrixD    fArot;        //! Rescaled response matrix
+   TMatrixD    fUortT;       //! Transposed left singular vectors of A*C^-1
+   TMatrixD    fVort;        //! Right singular vectors of A*C^-1
+   TMatrixD    fVreg;        //! C^-1 * right singular vectors
+   TVectorD    fASV;         //! Singular values of A*C^-1
+   TMatrixD    fXinv0;       //! Inverse covariance matrix before normalisation
+   Int_t       fNThreads;    //! Number of threads for response matrix pseudo experiments
+
    
    ClassDef( TSVDUnfold, 0 ) // Data unfolding using Singular Value Decomposition (hep-ph/9509307)   
 };
@@ -0,0 +1,398 @@
+// 'StJetFolder.cache.h'
+// Derek Anderson
+// 10.17.2026
+//
+// This class handles the unfolding of a provided spectrum.  This file
+// encapsulates the binary input cache.  'LoadInputs()' (given a
+// manifest with a cache directory) keys the five input spectra (after
+// the efficiency is smoothed) and the prepared response (vectors and
+// normalized matrix, as 'CacheResponse()' would compute them) by the
+// source files' paths, sizes and modification times, the object names
+// and the efficiency options, so finding the cache reads none of the
+// files.  The first job writes them to '<cDir>/StJetFolder.<key>.cache',
+// along with an md5 sum of the source files' contents (only computed
+// then); later jobs memory-map that file read-only instead of opening
+// the ROOT files, so jobs on one node share its pages.  The response
+// vectors and matrices are used straight from the mapping, which is
+// reference-counted: the folder that read the cache and every folder
+// given its inputs with 'SetInputs()' hold a reference, and the last
+// one to go unmaps it.  The histograms are rebuilt from it.
+//
+// The cache is a header (with a table of sections), followed by 8-byte
+// aligned sections of raw (native-endian) data.  Bump 'CacheVersion'
+// whenever the layout or the preparation of the inputs changes.
+//
+// Last updated: 10.17.2026
+
+
+#pragma once
+
+using namespace std;
+
+
+// cache layout
+const Int_t  CacheVersion = 2;
+const Int_t  NcacheHist   = Ninput;
+const Int_t  NcacheHsec   = 7;   // per histogram: shape, name, title, x edges, y edges, content, sumw2
+const Int_t  NcacheShape  = 20;  // dimension, nX, nY, entries, sumw2 flag, stats
+const Int_t  NcacheSec    = (NcacheHist * NcacheHsec) + NcacheRes;
+const Char_t CacheMagic[] = "SJFCACHE";
+
+// cache header
+struct StJetCacheHeader {
+  Char_t   magic[8];
+  Int_t    version;
+  Int_t    nSection;
+  Char_t   key[40];
+  Char_t   source[40];  // md5 of the source files' contents
+  Long64_t offset[NcacheSec];
+  Long64_t size[NcacheSec];   // in bytes
+};
+
+// cache mapping, shared by the folders using its arrays (references
+// are taken and dropped when folders are created and deleted, which
+// happens serially or under the scan's lock)
+struct StJetCacheMap {
+  void     *base;
+  Long64_t size;    // in bytes
+  Int_t    nUser;
+};
+
+
+
+TString StJetFolder::CacheFile(const TString &cDir, const TString &key) {
+
+  TString cFile(cDir);
+  cFile.Append("/StJetFolder.");
+  cFile.Append(key);
+  cFile.Append(".cache");
+  return cFile;
+
+}  // end 'CacheFile(TString&, TString&)'
+
+
+TString StJetFolder::CacheKey(const TString *files, const TString *names, const Bool_t doSmoothing, const Bool_t removeErrors) const {
+
+  // path, size and modification time of each file, names and
+  // options (empty if a file can't be found)
+  TString sKey("StJetFolder cache ");
+  sKey += CacheVersion;
+  for (Int_t iHist = 0; iHist < NcacheHist; iHist++) {
+    struct stat info;
+    if (stat(files[iHist].Data(), &info) != 0) return TString("");
+    sKey.Append(" ");
+    sKey.Append(files[iHist]);
+    sKey.Append(":");
+    sKey += (Long64_t) info.st_size;
+    sKey.Append(":");
+    sKey += (Long64_t) info.st_mtime;
+    sKey.Append(":");
+    sKey.Append(names[iHist]);
+  }
+  sKey.Append(doSmoothing  ? " smooth" : " raw");
+  sKey.Append(removeErrors ? " noErrors" : " errors");
+
+  TMD5 md5;
+  md5.Update((const UChar_t*) sKey.Data(), sKey.Length());
+  md5.Final();
+  return TString(md5.AsString());
+
+}  // end 'CacheKey(TString*, TString*, Bool_t, Bool_t)'
+
+
+TString StJetFolder::SourceSum(const TString *files) {
+
+  // md5 of the contents of each distinct file (empty if a file
+  // can't be read); only needed when a cache is written
+  TString sSum("");
+  for (Int_t iHist = 0; iHist < NcacheHist; iHist++) {
+    Bool_t isRepeat = false;
+    for (Int_t jHist = 0; jHist < iHist; jHist++) {
+      if (files[jHist] == files[iHist]) isRepeat = true;
+    }
+    if (isRepeat) continue;
+
+    TMD5 *fileSum = TMD5::FileChecksum(files[iHist].Data());
+    if (!fileSum) return TString("");
+    sSum.Append(fileSum -> AsString());
+    delete fileSum;
+  }
+
+  TMD5 md5;
+  md5.Update((const UChar_t*) sSum.Data(), sSum.Length());
+  md5.Final();
+  return TString(md5.AsString());
+
+}  // end 'SourceSum(TString*)'
+
+
+Bool_t StJetFolder::ReadCache(const TString &cFile, const TString &key) {
+
+  const Int_t fd = open(cFile.Data(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat info;
+  Bool_t isGood = ((fstat(fd, &info) == 0) && (info.st_size >= (off_t) sizeof(StJetCacheHeader)));
+  void   *map   = MAP_FAILED;
+  if (isGood) {
+    // read-only mapping: pages are shared by every job on the node
+    map = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) return false;
+
+  // check header and section table
+  const Char_t           *base   = (const Char_t*) map;
+  const StJetCacheHeader *header = (const StJetCacheHeader*) base;
+  isGood = (strncmp(header -> magic, CacheMagic, 8) == 0);
+  isGood = isGood && (header -> version == CacheVersion);
+  isGood = isGood && (header -> nSection == NcacheSec);
+  isGood = isGood && (key == TString(header -> key));
+  for (Int_t iSec = 0; isGood && (iSec < NcacheSec); iSec++) {
+    const Long64_t offset = header -> offset[iSec];
+    const Long64_t size   = header -> size[iSec];
+    if ((offset % 8 != 0) || (size < 0) || (offset < (Long64_t) sizeof(StJetCacheHeader)) || ((offset + size) > info.st_size))
+      isGood = false;
+  }
+
+  // rebuild histograms
+  TH1 *hists[NcacheHist];
+  for (Int_t iHist = 0; iHist < NcacheHist; iHist++) {
+    hists[iHist] = isGood ? ReadCacheHistogram(base, iHist) : 0;
+    if (!hists[iHist]) isGood = false;
+  }
+
+  // check prepared response against the response histogram
+  const Int_t iRes = NcacheHist * NcacheHsec;
+  if (isGood) {
+    const Long64_t nM = hists[3] -> GetNbinsX();
+    const Long64_t nT = hists[3] -> GetNbinsY();
+    const Long64_t sizes[NcacheRes] = {nM, nM, nM, nT, nT, nM * nT, nM * nT};
+    for (Int_t iCache = 0; iCache < NcacheRes; iCache++) {
+      if (header -> size[iRes + iCache] != (Long64_t) (sizes[iCache] * sizeof(Double_t))) isGood = false;
+    }
+  }
+
+  if (!isGood) {
+    for (Int_t iHist = 0; iHist < NcacheHist; iHist++) {
+      delete hists[iHist];
+    }
+    munmap(map, info.st_size);
+    return false;
+  }
+
+  for (Int_t iHist = 0; iHist < NcacheHist; iHist++) {
+    ReplaceInput(iHist, hists[iHist], true);
+    _flag[iHist] = true;
+  }
+  const Double_t *cacheRes[NcacheRes];
+  for (Int_t iCache = 0; iCache < NcacheRes; iCache++) {
+    cacheRes[iCache] = (const Double_t*) (base + header -> offset[iRes + iCache]);
+  }
+
+  // the mapping stays until the last folder using it is deleted
+  StJetCacheMap *cacheMap = new StJetCacheMap();
+  cacheMap -> base  = map;
+  cacheMap -> size  = info.st_size;
+  cacheMap -> nUser = 0;
+  AttachCache(cacheMap, cacheRes);
+  return true;
+
+}  // end 'ReadCache(TString&, TString&)'
+
+
+void StJetFolder::AttachCache(StJetCacheMap *map, const Double_t *const *cacheRes) {
+
+  // take a reference to a cache mapping (if any) and use its arrays
+  if (map) map -> nUser++;
+  ReleaseCache();
+
+  _cacheMap = map;
+  if (!map) return;
+  for (Int_t iCache = 0; iCache < NcacheRes; iCache++) {
+    _cacheRes[iCache] = cacheRes[iCache];
+  }
+
+}  // end 'AttachCache(StJetCacheMap*, Double_t**)'
+
+
+void StJetFolder::ReleaseCache() {
+
+  // drop this folder's reference, unmapping the cache with the last one
+  if (_cacheMap && (--(_cacheMap -> nUser) == 0)) {
+    munmap(_cacheMap -> base, _cacheMap -> size);
+    delete _cacheMap;
+  }
+  _cacheMap = 0;
+  for (Int_t iCache = 0; iCache < NcacheRes; iCache++) {
+    _cacheRes[iCache] = 0;
+  }
+
+}  // end 'ReleaseCache()'
+
+
+TH1* StJetFolder::ReadCacheHistogram(const Char_t *base, const Int_t iHist) {
+
+  const StJetCacheHeader *header = (const StJetCacheHeader*) base;
+  const Int_t            iSec    = iHist * NcacheHsec;
+  const Char_t           *sec[NcacheHsec];
+  Long64_t               size[NcacheHsec];
+  for (Int_t iHsec = 0; iHsec < NcacheHsec; iHsec++) {
+    sec[iHsec]  = base + header -> offset[iSec + iHsec];
+    size[iHsec] = header -> size[iSec + iHsec];
+  }
+  if (size[0] != (Long64_t) (NcacheShape * sizeof(Double_t))) return 0;
+
+  // names are stored with their terminating null
+  const Double_t *shape = (const Double_t*) sec[0];
+  const Int_t    nDim   = (Int_t) shape[0];
+  const Int_t    nX     = (Int_t) shape[1];
+  const Int_t    nY     = (Int_t) shape[2];
+  const Long64_t nCells = (nDim == 1) ? (nX + 2) : ((nX + 2) * (nY + 2));
+  const Long64_t nBytes = nCells * sizeof(Double_t);
+  if ((nDim < 1) || (nDim > 2) || (nX < 1) || ((nDim == 2) && (nY < 1))) return 0;
+  if ((size[1] < 1) || (sec[1][size[1] - 1] != '\0')) return 0;
+  if ((size[2] < 1) || (sec[2][size[2] - 1] != '\0')) return 0;
+  if (size[3] != (Long64_t) ((nX + 1) * sizeof(Double_t))) return 0;
+  if ((nDim == 2) && (size[4] != (Long64_t) ((nY + 1) * sizeof(Double_t)))) return 0;
+  if ((size[5] != nBytes) || ((size[6] != 0) && (size[6] != nBytes))) return 0;
+
+  TH1     *hist;
+  TArrayD *array;
+  if (nDim == 1) {
+    TH1D *hist1 = new TH1D(sec[1], sec[2], nX, (const Double_t*) sec[3]);
+    hist  = hist1;
+    array = hist1;
+  }
+  else {
+    TH2D *hist2 = new TH2D(sec[1], sec[2], nX, (const Double_t*) sec[3], nY, (const Double_t*) sec[4]);
+    hist  = hist2;
+    array = hist2;
+  }
+  hist -> SetDirectory(0);
+  if (size[6] > 0) {
+    hist -> Sumw2();
+    hist -> GetSumw2() -> Set(nCells, (const Double_t*) sec[6]);
+  }
+  array -> Set(nCells, (const Double_t*) sec[5]);
+
+  Double_t stats[NcacheShape - 5];
+  for (Int_t iStat = 0; iStat < (NcacheShape - 5); iStat++) {
+    stats[iStat] = shape[iStat + 5];
+  }
+  hist -> PutStats(stats);
+  hist -> SetEntries(shape[3]);
+  return hist;
+
+}  // end 'ReadCacheHistogram(Char_t*, Int_t)'
+
+
+Bool_t StJetFolder::WriteCache(const TString &cFile, const TString &key, const TString *files) const {
+
+  const TString source = SourceSum(files);
+  if (source.Length() == 0) return false;
+
+  StJetCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CacheMagic, 8);
+  header.version  = CacheVersion;
+  header.nSection = NcacheSec;
+  strncpy(header.key, key.Data(), sizeof(header.key) - 1);
+  strncpy(header.source, source.Data(), sizeof(header.source) - 1);
+
+  // histograms
+  vector<Char_t> body;
+  const TH1 *hists[NcacheHist] = {_hPrior, _hSmeared, _hMeasured, _hResponse, _hEfficiency};
+  for (Int_t iHist = 0; iHist < NcacheHist; iHist++) {
+    const TH1     *hist   = hists[iHist];
+    const TArrayD *array  = dynamic_cast<const TArrayD*>(hist);
+    const Int_t   iSec    = iHist * NcacheHsec;
+    const Int_t   nDim    = hist -> GetDimension();
+    if (!array || (nDim > 2)) return false;
+
+    Double_t shape[NcacheShape];
+    for (Int_t iShape = 0; iShape < NcacheShape; iShape++) {
+      shape[iShape] = 0.;
+    }
+    shape[0] = nDim;
+    shape[1] = hist -> GetNbinsX();
+    shape[2] = (nDim == 2) ? hist -> GetNbinsY() : 0;
+    shape[3] = hist -> GetEntries();
+    shape[4] = (hist -> GetSumw2N() > 0) ? 1. : 0.;
+    hist -> GetStats(shape + 5);
+
+    vector<Double_t> xEdges;
+    vector<Double_t> yEdges;
+    GetBinEdges(hist -> GetXaxis(), xEdges);
+    if (nDim == 2) GetBinEdges(hist -> GetYaxis(), yEdges);
+
+    const Long64_t nBytes = array -> GetSize() * sizeof(Double_t);
+    AddCacheSection(header, body, iSec + 0, shape, sizeof(shape));
+    AddCacheSection(header, body, iSec + 1, hist -> GetName(), strlen(hist -> GetName()) + 1);
+    AddCacheSection(header, body, iSec + 2, hist -> GetTitle(), strlen(hist -> GetTitle()) + 1);
+    AddCacheSection(header, body, iSec + 3, &xEdges[0], xEdges.size() * sizeof(Double_t));
+    AddCacheSection(header, body, iSec + 4, yEdges.empty() ? 0 : &yEdges[0], yEdges.size() * sizeof(Double_t));
+    AddCacheSection(header, body, iSec + 5, array -> GetArray(), nBytes);
+    if (hist -> GetSumw2N() > 0)
+      AddCacheSection(header, body, iSec + 6, hist -> GetSumw2() -> GetArray(), nBytes);
+    else
+      AddCacheSection(header, body, iSec + 6, 0, 0);
+  }
+
+  // prepared response, as 'Init()' would make it
+  RooUnfoldResponse response(0, 0, _hResponse);
+  const Int_t    nM        = response.GetNbinsMeasured();
+  const Int_t    nT        = response.GetNbinsTruth();
+  const Int_t    iRes      = NcacheHist * NcacheHsec;
+  const Double_t *arrays[NcacheRes] = {
+    response.Vmeasured().GetMatrixArray(),
+    response.Emeasured().GetMatrixArray(),
+    response.Vfakes().GetMatrixArray(),
+    response.Vtruth().GetMatrixArray(),
+    response.Etruth().GetMatrixArray(),
+    response.Mresponse().GetMatrixArray(),
+    response.Eresponse().GetMatrixArray()
+  };
+  const Int_t sizes[NcacheRes] = {nM, nM, nM, nT, nT, nM * nT, nM * nT};
+  for (Int_t iCache = 0; iCache < NcacheRes; iCache++) {
+    AddCacheSection(header, body, iRes + iCache, arrays[iCache], sizes[iCache] * sizeof(Double_t));
+  }
+
+  // write to a temporary file and rename, so concurrent jobs
+  // only ever see complete caches
+  TString tFile(cFile);
+  tFile.Append(".");
+  tFile += gSystem -> GetPid();
+  FILE *out = fopen(tFile.Data(), "wb");
+  if (!out) return false;
+
+  Bool_t isGood = (fwrite(&header, sizeof(header), 1, out) == 1);
+  if (isGood && !body.empty())
+    isGood = (fwrite(&body[0], 1, body.size(), out) == body.size());
+  isGood = (fclose(out) == 0) && isGood;
+  if (isGood)
+    isGood = (rename(tFile.Data(), cFile.Data()) == 0);
+  if (!isGood)
+    remove(tFile.Data());
+  return isGood;
+
+}  // end 'WriteCache(TString&, TString&, TString*)'
+
+
+void StJetFolder::AddCacheSection(StJetCacheHeader &header, vector<Char_t> &body, const Int_t iSec, const void *data, const Long64_t size) {
+
+  // sections start on 8-byte boundaries (offsets are from the
+  // start of the file)
+  while ((body.size() % 8) != 0) {
+    body.push_back(0);
+  }
+  header.offset[iSec] = sizeof(StJetCacheHeader) + body.size();
+  header.size[iSec]   = size;
+  if (size > 0) {
+    const Char_t *bytes = (const Char_t*) data;
+    body.insert(body.end(), bytes, bytes + size);
+  }
+
+}  // end 'AddCacheSection(StJetCacheHeader&, vector<Char_t>&, Int_t, void*, Long64_t)'
+
+// End ------------------------------------------------------------------------
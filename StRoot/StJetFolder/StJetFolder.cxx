@@ -7,7 +7,7 @@
 // routines.   Pearson Coefficient calculation adapted from Rhagav K.
 // Elayavalli.
 //
-// Last updated: 10.03.2018
+// Last updated: 10.17.2026
 
 
 #define StJetFolder_cxx
@@ -18,25 +18,43 @@
 #include "StJetFolder.sys.h"
 #include "StJetFolder.math.h"
 #include "StJetFolder.plot.h"
+#include "StJetFolder.thread.h"
+#include "StJetFolder.cache.h"
 
 ClassImp(StJetFolder)
 
 using namespace std;
 
 
+// no. of folders created (for unique names)
+Int_t StJetFolder::_nFolders = 0;
+
+
 
 void StJetFolder::Init() {
 
   Bool_t inputOK = CheckFlags();
   if (!inputOK) assert(inputOK);
 
-  // initialize response
-  if (_differentPrior) {
-    InitializePriors();
-    _response = new RooUnfoldResponse(0, 0, _hResponseDiff);
+  // kernel, priors and response may be shared from a prepared folder
+  if (!_isPrepared) {
+
+    // build smearing kernel from response
+    _smearKernel = new StJetSampler();
+    _smearKernel -> Build(_hResponse, _bMax);
+
+    // initialize response
+    if (_differentPrior) {
+      InitializePriors();
+      _response = new RooUnfoldResponse(0, 0, _hResponseDiff);
+    }
+    else {
+      _response = new RooUnfoldResponse(0, 0, _hResponse);
+      if (_cacheRes[0])
+        _response -> UseCache(_cacheRes[0], _cacheRes[1], _cacheRes[2], _cacheRes[3], _cacheRes[4], _cacheRes[5], _cacheRes[6]);
+    }
+    CacheResponse();
   }
-  else
-    _response = new RooUnfoldResponse(0, 0, _hResponse);
 
   if (_response) {
     PrintInfo(4);
@@ -54,44 +72,83 @@ void StJetFolder::Unfold(Double_t &chi2unfold) {
 
   PrintInfo(5);
 
+  // toys for the errors run on '_nThread' threads if more than one;
+  // each toy has its own stream, keyed by seed and configuration
+  const Int_t  nToyThread = (_nThread > 1) ? _nThread : 0;
+  const UInt_t toySeed    = StreamSeed(StreamToys, 0);
+  _rando -> SetSeed(StreamSeed(StreamSerial, 0));
+
   // do unfolding
-  RooUnfoldBayes    *bay;
-  RooUnfoldSvd      *svd;
-  RooUnfoldBinByBin *bin;
-  RooUnfoldTUnfold  *tun;
-  RooUnfoldInvert   *inv;
-  RooUnfoldErrors   *err;
-  TMatrixD          *cov;
+  RooUnfoldBayes    *bay = 0;
+  RooUnfoldSvd      *svd = 0;
+  RooUnfoldBinByBin *bin = 0;
+  RooUnfoldTUnfold  *tun = 0;
+  RooUnfoldInvert   *inv = 0;
+  RooUnfoldErrors   *err = 0;
+  TMatrixD          *cov = 0;
   switch (_method) {
     case 0:
       _hUnfolded = (TH1D*) _hMeasured -> Clone("hUnfolded");
+      cov        = new TMatrixD(_hMeasured -> GetNbinsX(), _hMeasured -> GetNbinsX());
+      for (Int_t i = 0; i < cov -> GetNrows(); i++) {
+        (*cov)(i, i) = TMath::Power(_hMeasured -> GetBinError(i + 1), 2.);
+      }
       break;
     case 1:
-      bay        = new RooUnfoldBayes(_response, _hMeasured, _kReg);
-      err        = new RooUnfoldErrors(_nToy, bay);
-      cov        = (TMatrixD*) bay -> Ereco().Clone();
-      _hUnfolded = (TH1D*)     bay -> Hreco();
+      if (_sweep) {
+        bay = _sweep -> _bayes;
+        if (!bay || (bay -> GetIterations() < _kReg)) {
+          PrintError(13);
+          assert(bay && (bay -> GetIterations() >= _kReg));
+        }
+        cov        = new TMatrixD(bay -> CovIter(_kReg));
+        _hUnfolded = (TH1D*) bay -> HrecoIter(_kReg);
+      }
+      else {
+        bay        = new RooUnfoldBayes(_response, _hMeasured, _kReg);
+        bay        -> SetRandomGenerator(_rando);
+        bay        -> SetToyThreads(nToyThread);
+        bay        -> SetToySeed(toySeed);
+        bay        -> SetSnapshots(_snapshots);
+        err        = new RooUnfoldErrors(_nToy, bay);
+        cov        = (TMatrixD*) bay -> Ereco().Clone();
+        _hUnfolded = (TH1D*)     bay -> Hreco();
+        _bayes     = bay;
+      }
       break;
     case 2:
       svd        = new RooUnfoldSvd(_response, _hMeasured, _kReg, _nToy);
+      svd        -> SetRandomGenerator(_rando);
+      svd        -> SetToyThreads(nToyThread);
+      svd        -> SetToySeed(toySeed);
       err        = new RooUnfoldErrors(_nToy, svd);
       cov        = (TMatrixD*) svd -> Ereco().Clone();
       _hUnfolded = (TH1D*)     svd -> Hreco();
       break;
     case 3:
       bin        = new RooUnfoldBinByBin(_response, _hMeasured);
+      bin        -> SetRandomGenerator(_rando);
+      bin        -> SetToyThreads(nToyThread);
+      bin        -> SetToySeed(toySeed);
       err        = new RooUnfoldErrors(_nToy, bin);
       cov        = (TMatrixD*) bin -> Ereco().Clone();
       _hUnfolded = (TH1D*)     bin -> Hreco();
       break;
     case 4:
       tun        = new RooUnfoldTUnfold(_response, _hMeasured, TUnfold::kRegModeDerivative);
+      tun        -> SetFastScan();
+      tun        -> SetRandomGenerator(_rando);
+      tun        -> SetToyThreads(nToyThread);
+      tun        -> SetToySeed(toySeed);
       err        = new RooUnfoldErrors(_nToy, tun);
       cov        = (TMatrixD*) tun -> Ereco().Clone();
       _hUnfolded = (TH1D*)     tun -> Hreco();
       break;
     case 5:
       inv        = new RooUnfoldInvert(_response, _hMeasured);
+      inv        -> SetRandomGenerator(_rando);
+      inv        -> SetToyThreads(nToyThread);
+      inv        -> SetToySeed(toySeed);
       err        = new RooUnfoldErrors(_nToy, inv);
       cov        = (TMatrixD*) inv -> Ereco().Clone();
       _hUnfolded = (TH1D*)     inv -> Hreco();
@@ -113,14 +170,21 @@ void StJetFolder::Unfold(Double_t &chi2unfold) {
       _hDvector      = (TH1D*) _hUnfolded -> Clone();
       break;
     case 1:
-      _hUnfoldErrors = (TH1D*) err -> UnfoldingError();
-      _hSVvector     = (TH1D*) bay -> Hreco();
-      _hDvector      = (TH1D*) bay -> Hreco();
+      if (_sweep) {
+        _hUnfoldErrors = GetSweepErrors(bay);
+        _hSVvector     = (TH1D*) bay -> HrecoIter(_kReg);
+        _hDvector      = (TH1D*) bay -> HrecoIter(_kReg);
+      }
+      else {
+        _hUnfoldErrors = (TH1D*) err -> UnfoldingError();
+        _hSVvector     = (TH1D*) bay -> Hreco();
+        _hDvector      = (TH1D*) bay -> Hreco();
+      }
       break;
     case 2:
       _hUnfoldErrors = (TH1D*) err -> UnfoldingError();
-      _hSVvector     = (TH1D*) svd -> Impl() -> GetSV();
-      _hDvector      = (TH1D*) svd -> Impl() -> GetD();
+      _hSVvector     = (TH1D*) svd -> Impl() -> GetSV() -> Clone();
+      _hDvector      = (TH1D*) svd -> Impl() -> GetD()  -> Clone();
       break;
     case 3:
       _hUnfoldErrors = (TH1D*) err -> UnfoldingError();
@@ -150,6 +214,35 @@ void StJetFolder::Unfold(Double_t &chi2unfold) {
     }
   }
 
+  // keep covariance of efficiency-corrected spectrum (for matrix backfolding)
+  if (_method != 0) {
+    const TH1D *hEff = _differentPrior ? _hEfficiencyDiff : _hEfficiency;
+    const Int_t nCov = cov -> GetNrows();
+    delete _covUnfold;
+    _covUnfold = new TMatrixD(*cov);
+    for (Int_t i = 0; i < nCov; i++) {
+      for (Int_t j = 0; j < nCov; j++) {
+        const Double_t effI = hEff -> GetBinContent(i + 1);
+        const Double_t effJ = hEff -> GetBinContent(j + 1);
+        const Double_t uI   = _hUnfolded -> GetBinLowEdge(i + 1);
+        const Double_t uJ   = _hUnfolded -> GetBinLowEdge(j + 1);
+        if ((effI > 0.) && (effJ > 0.) && (uI <= _uMax) && (uJ <= _uMax))
+          (*_covUnfold)(i, j) /= (effI * effJ);
+        else
+          (*_covUnfold)(i, j) = 0.;
+      }
+    }
+  }
+
+  // the bayesian unfolding is kept for folders taking their results
+  // from this one (see 'SetSweep()'); the rest is done with
+  delete err;
+  delete svd;
+  delete bin;
+  delete tun;
+  delete inv;
+  delete cov;
+
   // calculate chi2
   _chi2unfold = CalculateChi2(_hPrior, _hUnfolded);
   chi2unfold  = _chi2unfold;
@@ -176,15 +269,11 @@ void StJetFolder::Backfold(Double_t &chi2backfold) {
   _hBackfolded -> Reset("ICE");
 
 
-  // monte-carlo loop
-  Double_t u = 0.;
-  Double_t b = 0.;
-  for (Int_t i = 0; i < _nMC; i++) {
-    u = _hUnfolded -> GetRandom();
-    b = Smear(u);
-    _hNormalize -> Fill(u);
-    if (b > -1000.) _hBackfolded -> Fill(b);
-  }
+  // matrix or monte-carlo backfolding (the latter on '_nThread' threads)
+  if (_backMode == 1)
+    BackfoldMatrix();
+  else
+    BackfoldParallel();
 
   // normalize backfolded spectrum / apply efficiency
   Double_t iU = _hUnfolded  -> Integral();
@@ -215,48 +304,70 @@ void StJetFolder::Finish() {
   PrintInfo(9);
 
 
-  // set names
-  _hPrior        -> SetName("hPrior");
-  _hSmeared      -> SetName("hSmeared");
-  _hMeasured     -> SetName("hMeasured");
+  // set names (inputs may be shared with other folders, so they're
+  // written under their names instead of being renamed)
   _hUnfolded     -> SetName("hUnfolded");
   _hDvector      -> SetName("hDvector");
   _hSVvector     -> SetName("hSVvector");
   _hUnfoldErrors -> SetName("hUnfoldErrors");
-  _hEfficiency   -> SetName("hEfficiency");
   _hPearson      -> SetName("hPearson");
-  _hResponse     -> SetName("hResponse");
-  if (_differentPrior) {
-    _hEfficiencyDiff -> SetName("hEfficiencyDiff");
-    _hResponseDiff   -> SetName("hResponseDiff");
-  }
 
+  // plots can also be made later from the saved results (see 'Plot()')
   CreateLabel();
-  CreatePlots();
-  PrintInfo(11);
+  CreateUnfoldInfo();
+  if (_resultsOnly)
+    PrintInfo(15);
+  else {
+    // plots restyle the inputs
+    for (Int_t iIn = 0; iIn < Ninput; iIn++) {
+      OwnInput(iIn);
+    }
+    CreatePlots();
+    PrintInfo(11);
+  }
+
+  // parameters needed for plotting
+  TVectorD vFolding(NfoldPar);
+  vFolding(0) = _trigger;
+  vFolding(1) = _method;
+  vFolding(2) = _kReg;
+  vFolding(3) = _chi2unfold;
+  vFolding(4) = _chi2backfold;
+  vFolding(5) = _differentPrior ? 1. : 0.;
 
 
   // save and close file
   _fOut               -> cd();
-  _hPrior             -> Write();
-  _hSmeared           -> Write();
-  _hMeasured          -> Write();
+  _hPrior             -> Write("hPrior");
+  _hSmeared           -> Write("hSmeared");
+  _hMeasured          -> Write("hMeasured");
   _hUnfolded          -> Write();
-  _hNormalize         -> Write();
+  if (_hNormalize)
+    _hNormalize       -> Write();
   _hBackfolded        -> Write();
   _hBackVsMeasRatio   -> Write();
   _hUnfoldVsPriRatio  -> Write();
   _hSmearVsMeasRatio  -> Write();
   _hUnfoldVsMeasRatio -> Write();
+  _hSmearVsPriRatio   -> Write();
   _hPearson           -> Write();
   _hDvector           -> Write();
   _hSVvector          -> Write();
   _hUnfoldErrors      -> Write();
-  _hEfficiency        -> Write();
-  _hResponse          -> Write();
+  _hEfficiency        -> Write("hEfficiency");
+  _hResponse          -> Write("hResponse");
   if (_differentPrior) {
-    _hResponseDiff    -> Write();
-    _hEfficiencyDiff  -> Write();
+    _hResponseDiff    -> Write("hResponseDiff");
+    _hEfficiencyDiff  -> Write("hEfficiencyDiff");
+  }
+  _label              -> Write("pLabel");
+  _pInfo              -> Write("pInfo");
+  vFolding.Write("vFolding");
+
+  // histograms belong to the folder, not to the file
+  TH1 *hists[] = {_hUnfolded, _hNormalize, _hBackfolded, _hBackVsMeasRatio, _hUnfoldVsPriRatio, _hSmearVsMeasRatio, _hUnfoldVsMeasRatio, _hSmearVsPriRatio, _hPearson, _hDvector, _hSVvector, _hUnfoldErrors, _hResponseDiff, _hEfficiencyDiff};
+  for (UInt_t iHist = 0; iHist < (sizeof(hists) / sizeof(hists[0])); iHist++) {
+    if (hists[iHist]) hists[iHist] -> SetDirectory(0);
   }
   _fOut               -> Close();
   PrintInfo(12);
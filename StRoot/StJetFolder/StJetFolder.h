@@ -15,15 +15,22 @@
 //
 // Pearson Coefficient calculation adapted from Rhagav K. Elayavalli.
 //
-// Last updated: 10.03.2018
+// Last updated: 10.17.2026
 
 
 #ifndef StJetFolder_h
 #define StJetFolder_h
 
 #include <cmath>
+#include <cstdio>
 #include <cassert>
+#include <cstring>
 #include <iostream>
+// system includes (input cache)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 // ROOT includes
 #include "TF1.h"
 #include "TH1.h"
@@ -32,8 +39,10 @@
 #include "TROOT.h"
 #include "TFile.h"
 #include "TMath.h"
+#include "TMD5.h"
 #include "TLine.h"
 #include "TStyle.h"
+#include "TSystem.h"
 #include "TColor.h"
 #include "TString.h"
 #include "TCanvas.h"
@@ -41,6 +50,7 @@
 #include "TProfile.h"
 #include "TRandom3.h"
 #include "TMatrixD.h"
+#include "TVectorD.h"
 #include "TPaveText.h"
 #include "TSVDUnfold.h"
 // RooUnfold includes
@@ -51,6 +61,10 @@
 #include "../RooUnfold/RooUnfoldTUnfold.h"
 #include "../RooUnfold/RooUnfoldInvert.h"
 #include "../RooUnfold/RooUnfoldErrors.h"
+#include "../RooUnfold/RooUnfoldParallel.h"
+// user includes
+#include "StJetSampler.h"
+#include "StJetFolderManifest.h"
 
 using namespace std;
 
@@ -62,6 +76,27 @@ const Double_t Mpion     = 0.140;
 const Double_t UdefMax   = 100.;
 const Double_t BdefMax   = 100.;
 const Double_t XminPrior = 0.1;
+const UInt_t   DefSeed   = 65539;
+const Int_t    NgausPts  = 8;
+const Int_t    NgausSub  = 4;
+const Int_t    NbatchMC  = 1024;
+const Int_t    NchunkMC  = 262144;
+// random streams (streams are keyed by seed, configuration, stream
+// and chunk or toy index; see 'StreamSeed()')
+const UInt_t   StreamPrior    = 1;
+const UInt_t   StreamBackfold = 2;
+const UInt_t   StreamResponse = 3;
+const UInt_t   StreamToys     = 4;
+const UInt_t   StreamSerial   = 5;
+const Int_t    NfoldPar  = 6;
+// no. of input spectra (prior, smeared, measured, response,
+// efficiency) and of prepared response arrays in the input cache
+const Int_t    Ninput    = 5;
+const Int_t    NcacheRes = 7;
+
+
+struct StJetCacheHeader;
+struct StJetCacheMap;
 
 
 
@@ -81,8 +116,23 @@ public:
   void SetEventInfo(const Int_t beam, const Double_t energy);
   void SetTriggerInfo(const Int_t trigger, const Double_t eTmin, const Double_t eTmax, const Double_t hMax);
   void SetJetInfo(const Int_t type, const Int_t nRM, const Double_t rJet, const Double_t aMin, const Double_t pTmin);
-  void SetPriorParameters(const Int_t prior, const Double_t bPrior, const Double_t mPrior, const Double_t nPrior, const Double_t tPrior);
-  void SetUnfoldParameters(const Int_t method, const Int_t kReg, const Int_t nMC, const Int_t nToy, const Double_t uMax=UdefMax, const Double_t bMax=BdefMax);
+  void LoadInputs(const StJetFolderManifest &manifest);
+  void SetPriorParameters(const Int_t prior, const Double_t bPrior, const Double_t mPrior, const Double_t nPrior, const Double_t tPrior, const Int_t priorMode=0);
+  void SetUnfoldParameters(const Int_t method, const Int_t kReg, const Int_t nMC, const Int_t nToy, const Double_t uMax=UdefMax, const Double_t bMax=BdefMax, const Int_t backMode=0);
+  void SetThreads(const Int_t nThread, const UInt_t seed=DefSeed);
+  void SetCommonRandom(const Bool_t commonRandom=true);
+  void SetInputs(const StJetFolder *inputs);
+  void SetPrepared(const StJetFolder *prepared);
+  void SetSweep(const StJetFolder *sweep);
+  void SetSnapshots(const Bool_t snapshots=true);
+  void SetOutput(const Char_t *oFile);
+  void SetResultsOnly(const Bool_t resultsOnly=true);
+  // public getters
+  Bool_t   HasInputs() const;
+  TH1D*    GetUnfolded()    const {return _hUnfolded;}
+  TH1D*    GetBackfolded()  const {return _hBackfolded;}
+  Double_t GetChi2unfold()   const {return _chi2unfold;}
+  Double_t GetChi2backfold() const {return _chi2backfold;}
   // public methods ('StJetFolder.cxx')
   void Init();
   void Unfold(Double_t &chi2unfold);
@@ -94,21 +144,33 @@ public:
   static Double_t Tsallis(const Double_t *x, const Double_t *p);
   static Double_t Exponential(const Double_t *x, const Double_t *p);
   static Double_t PowerLaw(const Double_t *x, const Double_t *p);
+  // static public methods ('StJetFolder.plot.h')
+  static void     Plot(const Char_t *rFile, const Char_t *pFile=0);
 
 
 private:
 
   // atomic members
+  Int_t     _id;
   Int_t     _trigger;
   Int_t     _type;
   Int_t     _prior;
+  Int_t     _priorMode;
   Int_t     _method;
   Int_t     _kReg;
   Int_t     _nMC;
   Int_t     _nToy;
+  Int_t     _nThread;
+  Int_t     _backMode;
+  UInt_t    _seed;
   Bool_t    _differentPrior;
   Bool_t    _pearsonDebug;
+  Bool_t    _isPrepared;
+  Bool_t    _resultsOnly;
+  Bool_t    _commonRandom;
+  Bool_t    _snapshots;
   Bool_t    _flag[Nflag];
+  Bool_t    _ownInput[Ninput];
   Double_t  _bPrior;
   Double_t  _mPrior;
   Double_t  _nPrior;
@@ -118,10 +180,6 @@ private:
   Double_t  _uMax;
   Double_t  _bMax;
   // ROOT members
-  TF1       *_fLevy;
-  TF1       *_fTsallis;
-  TF1       *_fExponential;
-  TF1       *_fPowerLaw;
   TH1D      *_hPrior;
   TH1D      *_hSmeared;
   TH1D      *_hMeasured;
@@ -147,29 +205,76 @@ private:
   TString   *_sJet1;
   TString   *_sJet2;
   TString   *_sJet3;
-  TRandom   *_rando;
+  TRandom3  *_rando;
   TPaveText *_label;
   TPaveText *_pInfo;
+  TMatrixD  *_covUnfold;
+  // folder with a longer bayesian unfolding
+  const StJetFolder *_sweep;
+  // sampling tables
+  StJetSampler *_smearKernel;
   // RooUnfold members
   RooUnfoldResponse *_response;
+  RooUnfoldBayes    *_bayes;
+  // prepared response arrays (memory-mapped input cache), and this
+  // folder's reference to the mapping
+  const Double_t *_cacheRes[NcacheRes];
+  StJetCacheMap  *_cacheMap;
 
+  // private methods ('StJetFolder.io.h')
+  TH1*     GetInput(const Int_t iIn) const;
+  void     ReplaceInput(const Int_t iIn, TH1 *hist, const Bool_t isOwned);
+  void     OwnInput(const Int_t iIn);
+  void     LoadResults(TFile *fIn);
+  void     PrepareEfficiency(const Bool_t doSmoothing, const Bool_t removeErrors);
+  static void  ReadInputs(const Int_t nInput, const TString *files, const TString *names, TH1 **hists);
   // private methods ('StJetFolder.sys.h')
   void     PrintInfo(const Int_t code);
   void     PrintError(const Int_t code);
   void     InitializePriors();
+  void     NormalizeResponse();
+  void     CacheResponse();
   Bool_t   CheckFlags();
+  // private methods ('StJetFolder.cache.h')
+  TString  CacheKey(const TString *files, const TString *names, const Bool_t doSmoothing, const Bool_t removeErrors) const;
+  static TString CacheFile(const TString &cDir, const TString &key);
+  static TString SourceSum(const TString *files);
+  Bool_t   ReadCache(const TString &cFile, const TString &key);
+  void     AttachCache(StJetCacheMap *map, const Double_t *const *cacheRes);
+  void     ReleaseCache();
+  Bool_t   WriteCache(const TString &cFile, const TString &key, const TString *files) const;
+  static TH1*  ReadCacheHistogram(const Char_t *base, const Int_t iHist);
+  static void  AddCacheSection(StJetCacheHeader &header, vector<Char_t> &body, const Int_t iSec, const void *data, const Long64_t size);
   // private methods ('StJetFolder.plot.h')
   void     CreateLabel();
   void     CreatePlots();
   void     ResizeString(TString &str, const Int_t nDec);
+  TString  MakeName(const Char_t *base) const;
   void     DrawHistogram(TH1 *h, const Char_t *option, const Int_t mColor, const Int_t lColor, const Int_t fColor, const Int_t mStyle, const Int_t lStyle, const Int_t fStyle, const Double_t mSize);
   void     CreateUnfoldInfo();
   // private methods ('StJetFolder.math.h')
   TH1D*    CalculateRatio(const TH1D *hA, const TH1D *hB, const Char_t *rName);
   TH2D*    GetPearsonCoefficient(TMatrixD *mCovMat, Bool_t isInDebugMode=false, TString sHistName="");
-  UInt_t   ApplyEff(const Double_t par);
-  Double_t Smear(const Double_t yP);
+  void     BackfoldMatrix();
+  void     GeneratePrior();
+  Double_t IntegratePrior(const Double_t xLo, const Double_t xHi);
   Double_t CalculateChi2(const TH1D *hA, TH1D *hB);
+  TH1D*    GetSweepErrors(RooUnfoldBayes *bay);
+  // private methods ('StJetFolder.thread.h')
+  void     BackfoldParallel();
+  static void  BackfoldTask(Int_t iTask, void *arg);
+  static Int_t FindBin(const vector<Double_t> &edges, const Double_t x);
+  void     ResponseParallel(TH1D *hDetEffDif, TH1D *hParEffDif, TH1D *hSmearNorm);
+  static void  ResponseTask(Int_t iTask, void *arg);
+  static void  GetBinEdges(const TAxis *axis, vector<Double_t> &edges);
+  static void  AddCounts(vector<Double_t> &total, const vector< vector<Double_t> > &counts);
+  static void  FillFromCounts(TH1 *h, const vector<Double_t> &total);
+  UInt_t   PriorKey() const;
+  UInt_t   ConfigKey() const;
+  UInt_t   StreamSeed(const UInt_t stream, const UInt_t index) const;
+
+  // static members
+  static Int_t _nFolders;
   
 
 
@@ -184,11 +289,56 @@ private:
 
 StJetFolder::StJetFolder(const Char_t *oFile, const Bool_t pearDebug) {
 
-  _fOut  = new TFile(oFile, "recreate");
-  _rando = new TRandom();
+  // no output file = results only
+  if (oFile && (oFile[0] != '\0'))
+    _fOut = new TFile(oFile, "recreate");
+  else
+    _fOut = 0;
+  _rando = new TRandom3(RooUnfoldParallel::Seed(DefSeed, StreamSerial, 0));
+  _id    = _nFolders++;
+  _hPrior             = 0;
+  _hSmeared           = 0;
+  _hMeasured          = 0;
+  _hResponse          = 0;
+  _hEfficiency        = 0;
+  _hEfficiencyDiff    = 0;
+  _hResponseDiff      = 0;
+  _hUnfolded          = 0;
+  _hBackfolded        = 0;
+  _hNormalize         = 0;
+  _hBackVsMeasRatio   = 0;
+  _hUnfoldVsPriRatio  = 0;
+  _hSmearVsMeasRatio  = 0;
+  _hUnfoldVsMeasRatio = 0;
+  _hSmearVsPriRatio   = 0;
+  _hPearson           = 0;
+  _hDvector           = 0;
+  _hSVvector          = 0;
+  _hUnfoldErrors      = 0;
+  _smearKernel  = 0;
+  _nThread      = 1;
+  _seed         = DefSeed;
+  _backMode     = 0;
+  _covUnfold    = 0;
+  _isPrepared   = false;
+  _resultsOnly  = false;
+  _commonRandom = false;
+  _snapshots    = false;
+  _label        = 0;
+  _pInfo        = 0;
+  _sweep        = 0;
+  _bayes        = 0;
+  _response     = 0;
+  _cacheMap     = 0;
+  for (Int_t i = 0; i < NcacheRes; i++) {
+    _cacheRes[i] = 0;
+  }
   for (Int_t i = 0; i < Nflag; i++) {
     _flag[i] = false;
   }
+  for (Int_t i = 0; i < Ninput; i++) {
+    _ownInput[i] = false;
+  }
   _pearsonDebug = pearDebug;
   PrintInfo(0);
 
@@ -197,6 +347,43 @@ StJetFolder::StJetFolder(const Char_t *oFile, const Bool_t pearDebug) {
 
 StJetFolder::~StJetFolder() {
 
+  // kernel, response and regenerated priors of a prepared folder
+  // belong to the folder which built them
+  if (!_isPrepared) {
+    delete _smearKernel;
+    delete _response;
+    delete _hResponseDiff;
+    delete _hEfficiencyDiff;
+  }
+  delete _bayes;
+  delete _covUnfold;
+  delete _rando;
+
+  // results (before the output file, which may still hold some)
+  delete _hUnfolded;
+  delete _hBackfolded;
+  delete _hNormalize;
+  delete _hBackVsMeasRatio;
+  delete _hUnfoldVsPriRatio;
+  delete _hSmearVsMeasRatio;
+  delete _hUnfoldVsMeasRatio;
+  delete _hSmearVsPriRatio;
+  delete _hPearson;
+  delete _hDvector;
+  delete _hSVvector;
+  delete _hUnfoldErrors;
+  delete _label;
+  delete _pInfo;
+  delete _fOut;
+
+  // inputs shared from another folder belong to that folder
+  for (Int_t iIn = 0; iIn < Ninput; iIn++) {
+    if (_ownInput[iIn]) delete GetInput(iIn);
+  }
+
+  // release the input cache only after the response which uses it
+  ReleaseCache();
+
 }  // end '~StJetFolder()'
 
 #endif
@@ -5,7 +5,7 @@
 // This class handles the unfolding of a provided spectrum.  This file
 // encapsulates I/O routines.
 //
-// Last updated: 08.23.2018
+// Last updated: 10.17.2026
 
 
 #pragma once
@@ -16,19 +16,14 @@ using namespace std;
 
 void StJetFolder::SetPrior(const Char_t *pFile, const Char_t *pName) {
 
-  TFile *fPrior = (TFile*) gROOT -> GetListOfFiles() -> FindObject(pFile);
-  if (!fPrior || !fPrior->IsOpen()) {
-    fPrior = new TFile(pFile);
-  }
-
-  TH1D *hPrior;
-  if (fPrior) {
-    hPrior = (TH1D*) fPrior -> Get(pName);
-  }
+  const TString file(pFile);
+  const TString name(pName);
+  TH1 *hPrior;
+  ReadInputs(1, &file, &name, &hPrior);
 
 
   if (hPrior) {
-    _hPrior  = (TH1D*) hPrior -> Clone();
+    ReplaceInput(0, hPrior, true);
     _flag[0] = true;
   }
   else {
@@ -41,19 +36,14 @@ void StJetFolder::SetPrior(const Char_t *pFile, const Char_t *pName) {
 
 void StJetFolder::SetSmeared(const Char_t *sFile, const Char_t *sName) {
 
-  TFile *fSmeared = (TFile*) gROOT -> GetListOfFiles() -> FindObject(sFile);
-  if (!fSmeared || !fSmeared->IsOpen()) {
-    fSmeared = new TFile(sFile);
-  }
-
-  TH1D *hSmeared;
-  if (fSmeared) {
-    hSmeared = (TH1D*) fSmeared -> Get(sName);
-  }
+  const TString file(sFile);
+  const TString name(sName);
+  TH1 *hSmeared;
+  ReadInputs(1, &file, &name, &hSmeared);
 
 
   if (hSmeared) {
-    _hSmeared = (TH1D*) hSmeared -> Clone();
+    ReplaceInput(1, hSmeared, true);
     _flag[1]  = true;
   }
   else {
@@ -66,19 +56,14 @@ void StJetFolder::SetSmeared(const Char_t *sFile, const Char_t *sName) {
 
 void StJetFolder::SetMeasured(const Char_t *mFile, const Char_t *mName) {
 
-  TFile *fMeasured = (TFile*) gROOT -> GetListOfFiles() -> FindObject(mFile);
-  if (!fMeasured || !fMeasured->IsOpen()) {
-    fMeasured = new TFile(mFile);
-  }
-
-  TH1D *hMeasured;
-  if (fMeasured) {
-    hMeasured = (TH1D*) fMeasured -> Get(mName);
-  }
+  const TString file(mFile);
+  const TString name(mName);
+  TH1 *hMeasured;
+  ReadInputs(1, &file, &name, &hMeasured);
 
 
   if (hMeasured) {
-    _hMeasured = (TH1D*) hMeasured -> Clone();
+    ReplaceInput(2, hMeasured, true);
     _flag[2]   = true;
   }
   else {
@@ -91,19 +76,14 @@ void StJetFolder::SetMeasured(const Char_t *mFile, const Char_t *mName) {
 
 void StJetFolder::SetResponse(const Char_t *rFile, const Char_t *rName) {
 
-  TFile *fResponse = (TFile*) gROOT -> GetListOfFiles() -> FindObject(rFile);
-  if (!fResponse || !fResponse->IsOpen()) {
-    fResponse = new TFile(rFile);
-  }
-
-  TH2D *hResponse;
-  if (fResponse) {
-    hResponse = (TH2D*) fResponse -> Get(rName);
-  }
+  const TString file(rFile);
+  const TString name(rName);
+  TH1 *hResponse;
+  ReadInputs(1, &file, &name, &hResponse);
 
 
   if (hResponse) {
-    _hResponse = (TH2D*) hResponse -> Clone();
+    ReplaceInput(3, hResponse, true);
     _flag[3]   = true;
   }
   else {
@@ -116,35 +96,82 @@ void StJetFolder::SetResponse(const Char_t *rFile, const Char_t *rName) {
 
 void StJetFolder::SetEfficiency(const Char_t *eFile, const Char_t *eName, const Bool_t doSmoothing, const Bool_t removeErrors) {
 
-  TFile *fEfficiency = (TFile*) gROOT -> GetListOfFiles() -> FindObject(eFile);
-  if (!fEfficiency || !fEfficiency->IsOpen()) {
-    fEfficiency = new TFile(eFile);
-  }
-
-  TH1D *hEfficiency;
-  if (fEfficiency) {
-    hEfficiency = (TH1D*) fEfficiency -> Get(eName);
-  }
+  const TString file(eFile);
+  const TString name(eName);
+  TH1 *hEfficiency;
+  ReadInputs(1, &file, &name, &hEfficiency);
 
 
   if (hEfficiency) {
-    _hEfficiency = (TH1D*) hEfficiency -> Clone();
+    ReplaceInput(4, hEfficiency, true);
     _flag[4]     = true;
   }
   else {
     PrintError(4);
     assert(hEfficiency);
   }
+  PrepareEfficiency(doSmoothing, removeErrors);
+
+}  // end 'SetEfficiency(Char_t*, Char_t*, Bool_t, Bool_t)'
+
+
+void StJetFolder::LoadInputs(const StJetFolderManifest &manifest) {
+
+  // same order as '_flag[0..4]'
+  const TString files[Ninput] = {manifest.pFile, manifest.sFile, manifest.mFile, manifest.rFile, manifest.eFile};
+  const TString names[Ninput] = {manifest.pName, manifest.sName, manifest.mName, manifest.rName, manifest.eName};
+
+  // arrays from an earlier input cache don't go with the new inputs
+  ReleaseCache();
+
+  // try the binary input cache first
+  TString key("");
+  TString cFile("");
+  if (manifest.cacheDir.Length() > 0) {
+    key   = CacheKey(files, names, manifest.smooth, manifest.noErrors);
+    cFile = CacheFile(manifest.cacheDir, key);
+    if ((key.Length() > 0) && ReadCache(cFile, key)) {
+      PrintInfo(16);
+      return;
+    }
+  }
+
+  // open each distinct file once
+  TH1 *hists[Ninput];
+  ReadInputs(Ninput, files, names, hists);
+  for (Int_t iIn = 0; iIn < Ninput; iIn++) {
+    if (!hists[iIn]) {
+      PrintError(iIn);
+      assert(hists[iIn]);
+    }
+    ReplaceInput(iIn, hists[iIn], true);
+    _flag[iIn] = true;
+  }
+  PrepareEfficiency(manifest.smooth, manifest.noErrors);
+
+  // write cache for the next job
+  if (key.Length() == 0) return;
+  gSystem -> mkdir(manifest.cacheDir.Data(), kTRUE);
+  if (WriteCache(cFile, key, files))
+    PrintInfo(17);
+  else
+    PrintError(15);
+
+}  // end 'LoadInputs(StJetFolderManifest&)'
+
+
+void StJetFolder::PrepareEfficiency(const Bool_t doSmoothing, const Bool_t removeErrors) {
 
   // smooth efficiency at high pT
   const Float_t fitGuess(0.87);
   const Float_t fitRange[2] = {10., 30.};
   if (doSmoothing) {
-    TF1 *fFit = new TF1("fFit", "[0]", fitRange[0], fitRange[1]);
+    const TString sFit(MakeName("fFit"));
+    TF1 *fFit = new TF1(sFit.Data(), "[0]", fitRange[0], fitRange[1]);
     fFit -> SetParameter(0, fitGuess);
 
     _hEfficiency -> Fit(fFit, "RQ0");
-    if (_hEfficiency -> GetFunction("fFit")) {
+    if (_hEfficiency -> GetFunction(sFit.Data())) {
       const UInt_t nBins  = _hEfficiency -> GetNbinsX();
       const UInt_t iStart = _hEfficiency -> FindBin(fitRange[0]);
       for (UInt_t iBin = iStart; iBin < (nBins + 1); iBin++) {
@@ -169,7 +196,52 @@ void StJetFolder::SetEfficiency(const Char_t *eFile, const Char_t *eName, const
     }  // end bin loop
   }  // end removing bin errors
 
-}  // end 'SetEfficiency(Char_t*, Char_t*)'
+}  // end 'PrepareEfficiency(Bool_t, Bool_t)'
+
+
+void StJetFolder::ReadInputs(const Int_t nInput, const TString *files, const TString *names, TH1 **hists) {
+
+  // each distinct file is opened once (unless someone else already
+  // has it open), all of its keys are read, and it is closed again;
+  // the copies are detached from any directory and belong to the
+  // folder
+  const Bool_t addDir = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+
+  vector<Bool_t> isRead(nInput, false);
+  for (Int_t iIn = 0; iIn < nInput; iIn++) {
+    hists[iIn] = 0;
+  }
+  for (Int_t iIn = 0; iIn < nInput; iIn++) {
+    if (isRead[iIn]) continue;
+
+    TFile        *file   = (TFile*) gROOT -> GetListOfFiles() -> FindObject(files[iIn].Data());
+    const Bool_t wasOpen = (file && file -> IsOpen());
+    if (!wasOpen) {
+      file = new TFile(files[iIn].Data(), "read");
+    }
+
+    for (Int_t jIn = iIn; jIn < nInput; jIn++) {
+      if (files[jIn] != files[iIn]) continue;
+      isRead[jIn] = true;
+      if (!file -> IsOpen()) continue;
+
+      TH1 *hist = (TH1*) file -> Get(names[jIn].Data());
+      if (hist) {
+        hists[jIn] = (TH1*) hist -> Clone();
+        hists[jIn] -> SetDirectory(0);
+      }
+    }
+
+    if (!wasOpen) {
+      file -> Close();
+      delete file;
+    }
+  }  // end input loop
+
+  TH1::AddDirectory(addDir);
+
+}  // end 'ReadInputs(Int_t, TString*, TString*, TH1**)'
 
 
 void StJetFolder::SetEventInfo(const Int_t beam, const Double_t energy) {
@@ -331,50 +403,237 @@ void StJetFolder::SetJetInfo(const Int_t type, const Int_t nRM, const Double_t r
 }  // end 'SetJetInfo(Int_t, Int_t, Double_t, Double_t, Double_t)'
 
 
-void StJetFolder::SetPriorParameters(const Int_t prior, const Double_t bPrior, const Double_t mPrior, const Double_t nPrior, const Double_t tPrior) {
+void StJetFolder::SetPriorParameters(const Int_t prior, const Double_t bPrior, const Double_t mPrior, const Double_t nPrior, const Double_t tPrior, const Int_t priorMode) {
 
-  _prior  = prior;
-  _bPrior = bPrior;
-  _mPrior = mPrior;
-  _nPrior = nPrior;
-  _tPrior = tPrior;
+  // priorMode: 0 = integrate over bins, 1 = sample (nMC draws)
+  _prior     = prior;
+  _bPrior    = bPrior;
+  _mPrior    = mPrior;
+  _nPrior    = nPrior;
+  _tPrior    = tPrior;
+  _priorMode = priorMode;
   if (_prior > 0)
     _differentPrior = true;
   else
     _differentPrior = false;
 
-  // create prior functions
-  const Double_t nBinsP = _hPrior -> GetNbinsX();
-  const Double_t stopP  = _hPrior -> GetBinLowEdge(nBinsP + 1);
-  const Double_t startP = XminPrior;
-  _fLevy        = new TF1("fLevy", StJetFolder::Levy, startP, stopP, 4);
-  _fTsallis     = new TF1("fTsallis", StJetFolder::Tsallis, startP, stopP, 3);
-  _fExponential = new TF1("fExponential", StJetFolder::Exponential, startP, stopP, 2);
-  _fPowerLaw    = new TF1("fPowerLaw", StJetFolder::PowerLaw, startP, stopP, 2);
-  _fLevy        -> SetParameters(_bPrior, _mPrior, _nPrior, _tPrior);
-  _fTsallis     -> SetParameters(_bPrior, _nPrior, _tPrior);
-  _fExponential -> SetParameters(_bPrior, _tPrior);
-  _fPowerLaw    -> SetParameters(_bPrior, _tPrior);
-
 
   _flag[8] = true;
 
-}  // end 'SetPriorParameters(Int_t, Double_t, Double_t, Double_t, Double_t)'
+}  // end 'SetPriorParameters(Int_t, Double_t, Double_t, Double_t, Double_t, Int_t)'
 
 
-void StJetFolder::SetUnfoldParameters(const Int_t method, const Int_t kReg, const Int_t nMC, const Int_t nToy, const Double_t uMax, const Double_t bMax) {
+void StJetFolder::SetUnfoldParameters(const Int_t method, const Int_t kReg, const Int_t nMC, const Int_t nToy, const Double_t uMax, const Double_t bMax, const Int_t backMode) {
 
-  _method = method;
-  _kReg   = kReg;
-  _nMC    = nMC;
-  _nToy   = nToy;
-  _uMax   = uMax;
-  _bMax   = bMax;
+  // backMode: 0 = monte-carlo, 1 = matrix (exact)
+  _method   = method;
+  _kReg     = kReg;
+  _nMC      = nMC;
+  _nToy     = nToy;
+  _uMax     = uMax;
+  _bMax     = bMax;
+  _backMode = backMode;
 
 
   _flag[9] = true;
 
-}  // end 'SetUnfoldParameters(Int_t, Int_t, Int_t)'
+}  // end 'SetUnfoldParameters(Int_t, Int_t, Int_t, Int_t, Double_t, Double_t, Int_t)'
+
+
+void StJetFolder::SetThreads(const Int_t nThread, const UInt_t seed) {
+
+  // 1 = run serially; results depend only on the seed
+  _nThread = (nThread > 1) ? nThread : 1;
+  _seed    = seed;
+
+}  // end 'SetThreads(Int_t, UInt_t)'
+
+
+void StJetFolder::SetCommonRandom(const Bool_t commonRandom) {
+
+  // use the same random numbers for every configuration (common
+  // random numbers), instead of independent ones for each
+  _commonRandom = commonRandom;
+
+}  // end 'SetCommonRandom(Bool_t)'
+
+
+void StJetFolder::SetOutput(const Char_t *oFile) {
+
+  // open output file after the fact (e.g. for a results-only folder)
+  if (_fOut) return;
+  _fOut = new TFile(oFile, "recreate");
+  PrintInfo(0);
+
+}  // end 'SetOutput(Char_t*)'
+
+
+void StJetFolder::SetInputs(const StJetFolder *inputs) {
+
+  // share spectra already loaded (and smoothed) by another folder;
+  // they're only read, and copied first where this folder changes
+  // them (see 'OwnInput()')
+  for (Int_t iIn = 0; iIn < Ninput; iIn++) {
+    ReplaceInput(iIn, inputs -> GetInput(iIn), false);
+  }
+
+  // labels are read-only, so they can be shared
+  _trigger = inputs -> _trigger;
+  _sEvnt   = inputs -> _sEvnt;
+  _sTrig   = inputs -> _sTrig;
+  _sJet1   = inputs -> _sJet1;
+  _sJet2   = inputs -> _sJet2;
+  _sJet3   = inputs -> _sJet3;
+  for (Int_t i = 0; i < 8; i++) {
+    _flag[i] = inputs -> _flag[i];
+  }
+
+  // prepared response from the input cache (if any) is read-only
+  // too; the folder keeps the mapping alive while it uses it
+  AttachCache(inputs -> _cacheMap, inputs -> _cacheRes);
+
+}  // end 'SetInputs(StJetFolder*)'
+
+
+void StJetFolder::SetPrepared(const StJetFolder *prepared) {
+
+  // share kernel and response of an initialized folder with the
+  // same prior and response settings, instead of rebuilding them
+  // (its regenerated priors are only read, like the inputs)
+  _smearKernel = prepared -> _smearKernel;
+  _response    = prepared -> _response;
+  if (_differentPrior) {
+    ReplaceInput(0, prepared -> _hPrior, false);
+    ReplaceInput(1, prepared -> _hSmeared, false);
+    _hResponseDiff   = prepared -> _hResponseDiff;
+    _hEfficiencyDiff = prepared -> _hEfficiencyDiff;
+  }
+  _isPrepared = true;
+
+}  // end 'SetPrepared(StJetFolder*)'
+
+
+void StJetFolder::SetSweep(const StJetFolder *sweep) {
+
+  // take bayesian results after '_kReg' iterations from a folder
+  // which already unfolded with more iterations (and the same
+  // prior / response), instead of unfolding again
+  _sweep = sweep;
+
+}  // end 'SetSweep(StJetFolder*)'
+
+
+void StJetFolder::SetSnapshots(const Bool_t snapshots) {
+
+  // keep the bayesian results after every iteration, so that folders
+  // with fewer iterations can take theirs from this one (see 'SetSweep()')
+  _snapshots = snapshots;
+
+}  // end 'SetSnapshots(Bool_t)'
+
+
+void StJetFolder::SetResultsOnly(const Bool_t resultsOnly) {
+
+  // write only the numerical results in 'Finish()' (the plots can
+  // be made later with 'Plot()')
+  _resultsOnly = resultsOnly;
+
+}  // end 'SetResultsOnly(Bool_t)'
+
+
+TH1* StJetFolder::GetInput(const Int_t iIn) const {
+
+  // same order as '_flag[0..4]'
+  TH1 *inputs[Ninput] = {_hPrior, _hSmeared, _hMeasured, _hResponse, _hEfficiency};
+  return inputs[iIn];
+
+}  // end 'GetInput(Int_t)'
+
+
+void StJetFolder::ReplaceInput(const Int_t iIn, TH1 *hist, const Bool_t isOwned) {
+
+  // delete the old input (unless it belongs to another folder)
+  TH1 *old = GetInput(iIn);
+  if (_ownInput[iIn] && (old != hist)) delete old;
+
+  switch (iIn) {
+    case 0:
+      _hPrior = (TH1D*) hist;
+      break;
+    case 1:
+      _hSmeared = (TH1D*) hist;
+      break;
+    case 2:
+      _hMeasured = (TH1D*) hist;
+      break;
+    case 3:
+      _hResponse = (TH2D*) hist;
+      break;
+    case 4:
+      _hEfficiency = (TH1D*) hist;
+      break;
+  }
+  _ownInput[iIn] = isOwned;
+
+}  // end 'ReplaceInput(Int_t, TH1*, Bool_t)'
+
+
+void StJetFolder::OwnInput(const Int_t iIn) {
+
+  // copy an input shared from another folder before changing it
+  TH1 *hist = GetInput(iIn);
+  if (_ownInput[iIn] || !hist) return;
+
+  TH1 *copy = (TH1*) hist -> Clone();
+  copy -> SetDirectory(0);
+  ReplaceInput(iIn, copy, true);
+
+}  // end 'OwnInput(Int_t)'
+
+
+void StJetFolder::LoadResults(TFile *fIn) {
+
+  ReplaceInput(0, (TH1*) fIn -> Get("hPrior"),      true);
+  ReplaceInput(1, (TH1*) fIn -> Get("hSmeared"),    true);
+  ReplaceInput(2, (TH1*) fIn -> Get("hMeasured"),   true);
+  ReplaceInput(3, (TH1*) fIn -> Get("hResponse"),   true);
+  ReplaceInput(4, (TH1*) fIn -> Get("hEfficiency"), true);
+  _hUnfolded          = (TH1D*)      fIn -> Get("hUnfolded");
+  _hBackfolded        = (TH1D*)      fIn -> Get("hBackfolded");
+  _hBackVsMeasRatio   = (TH1D*)      fIn -> Get("hBackVsMeasRatio");
+  _hUnfoldVsPriRatio  = (TH1D*)      fIn -> Get("hUnfoldVsPriRatio");
+  _hSmearVsMeasRatio  = (TH1D*)      fIn -> Get("hSmearVsMeasRatio");
+  _hUnfoldVsMeasRatio = (TH1D*)      fIn -> Get("hUnfoldVsMeasRatio");
+  _hSmearVsPriRatio   = (TH1D*)      fIn -> Get("hSmearVsPriRatio");
+  _label              = (TPaveText*) fIn -> Get("pLabel");
+  _pInfo              = (TPaveText*) fIn -> Get("pInfo");
+
+  TVectorD *vFolding = (TVectorD*) fIn -> Get("vFolding");
+  Bool_t   isGood    = (vFolding != 0);
+  if (isGood) {
+    _trigger        = (Int_t) (*vFolding)(0);
+    _method         = (Int_t) (*vFolding)(1);
+    _kReg           = (Int_t) (*vFolding)(2);
+    _chi2unfold     = (*vFolding)(3);
+    _chi2backfold   = (*vFolding)(4);
+    _differentPrior = ((*vFolding)(5) > 0.);
+  }
+  delete vFolding;
+  if (isGood && _differentPrior) {
+    _hResponseDiff   = (TH2D*) fIn -> Get("hResponseDiff");
+    _hEfficiencyDiff = (TH1D*) fIn -> Get("hEfficiencyDiff");
+    if (!_hResponseDiff || !_hEfficiencyDiff) isGood = false;
+  }
+
+  const Bool_t hasSpectra = (_hPrior && _hSmeared && _hMeasured && _hUnfolded && _hBackfolded);
+  const Bool_t hasRatios  = (_hBackVsMeasRatio && _hUnfoldVsPriRatio && _hSmearVsMeasRatio && _hUnfoldVsMeasRatio && _hSmearVsPriRatio);
+  const Bool_t hasOthers  = (_hEfficiency && _hResponse && _label && _pInfo);
+  if (!isGood || !hasSpectra || !hasRatios || !hasOthers) {
+    PrintError(14);
+    assert(isGood && hasSpectra && hasRatios && hasOthers);
+  }
+
+}  // end 'LoadResults(TFile*)'
 
 // End ------------------------------------------------------------------------
 
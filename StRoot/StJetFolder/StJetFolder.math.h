@@ -6,7 +6,7 @@
 // encapsulates various mathematical routines.  Pearson Coefficient
 // calculation adapted from Rhagav K. Elayavalli.
 //
-// Last updated: 10.03.2018
+// Last updated: 10.17.2026
 
 
 #pragma once
@@ -141,48 +141,198 @@ TH2D* StJetFolder::GetPearsonCoefficient(TMatrixD *mCovMat, Bool_t isInDebugMode
          << " ========      Calculation finished!!      ======== \n"
          << endl;
   }
+  delete mPears;
   return hPears;
 
 }  // end 'GetPearsonCoefficienct(TMatrixD*, Bool_t, TString)'
 
 
 
-UInt_t StJetFolder::ApplyEff(const Double_t par) {
+void StJetFolder::BackfoldMatrix() {
 
-  const UInt_t   bin = _hEfficiency -> FindBin(par);
-  const Double_t eff = _hEfficiency -> GetBinContent(bin);
-  const Double_t ran = _rando       -> Uniform(0., 1.);
-  const Double_t bad = (ran > eff);
+  // bin edges (under- and overflow are open-ended)
+  vector<Double_t> uEdges;
+  vector<Double_t> yEdges;
+  vector<Double_t> bEdges;
+  GetBinEdges(_hUnfolded   -> GetXaxis(), uEdges);
+  GetBinEdges(_hResponse   -> GetYaxis(), yEdges);
+  GetBinEdges(_hBackfolded -> GetXaxis(), bEdges);
 
-  UInt_t returnVal(1);
-  if (bad)
-    returnVal = 0;
-  return returnVal;
+  const Int_t nU = _hUnfolded   -> GetNbinsX();
+  const Int_t nY = _hResponse   -> GetNbinsY();
+  const Int_t nB = _hBackfolded -> GetNbinsX() + 2;
 
-}  // end 'ApplyEff(Double_t)'
 
+  // fold(b, u) = probability for a value in unfolded bin u to land in
+  // backfolded bin b, with the same kernel (and bMax cut) as the
+  // monte-carlo backfolding
+  TMatrixD fold(nB, nU);
+  for (Int_t iU = 0; iU < nU; iU++) {
+    const Double_t uLo = uEdges[iU];
+    const Double_t uHi = uEdges[iU + 1];
+    const Double_t uW  = uHi - uLo;
 
+    for (Int_t iRow = _smearKernel -> FindRow(uLo); iRow < (nY + 2); iRow++) {
+      const Double_t yLo = (iRow == 0)      ? -NoLimit : yEdges[iRow - 1];
+      const Double_t yHi = (iRow == nY + 1) ?  NoLimit : yEdges[iRow];
+      if (yLo >= uHi) break;
+      if (_smearKernel -> IsEmpty(iRow)) continue;
 
-Double_t StJetFolder::Smear(const Double_t yP) {
+      // fraction of unfolded bin in this response row
+      const Double_t overlap = TMath::Min(uHi, yHi) - TMath::Max(uLo, yLo);
+      if (overlap <= 0.) continue;
 
-  TH1D     *hSmear;
-  Int_t    iPrior;
-  Int_t    nSmear;
-  Double_t xS;
+      const Double_t frac = overlap / uW;
+      for (Int_t iB = 0; iB < nB; iB++) {
+        const Double_t bLo = (iB == 0)      ? -NoLimit : bEdges[iB - 1];
+        const Double_t bHi = (iB == nB - 1) ?  NoLimit : bEdges[iB];
+        fold(iB, iU) += frac * _smearKernel -> GetProbability(iRow, bLo, bHi);
+      }
+    }
+  }
+
+
+  // backfold
+  TVectorD unfold(nU);
+  for (Int_t iU = 0; iU < nU; iU++) {
+    unfold(iU) = _hUnfolded -> GetBinContent(iU + 1);
+  }
+  TVectorD back = fold * unfold;
+
+  // propagate unfolded covariance
+  TMatrixD covBack(nB, nB);
+  if (_covUnfold && (_covUnfold -> GetNrows() == nU)) {
+    TMatrixD covFold(fold, TMatrixD::kMult, *_covUnfold);
+    covBack = TMatrixD(covFold, TMatrixD::kMultTranspose, fold);
+  }
+
+  for (Int_t iB = 0; iB < nB; iB++) {
+    const Double_t var = covBack(iB, iB);
+    _hBackfolded -> SetBinContent(iB, back(iB));
+    _hBackfolded -> SetBinError(iB, (var > 0.) ? TMath::Sqrt(var) : 0.);
+  }
+
+  // no sampling: normalization is the unfolded spectrum itself
+  _hNormalize -> Add(_hUnfolded);
+
+}  // end 'BackfoldMatrix()'
 
-  iPrior = _hResponse -> GetYaxis() -> FindBin(yP);
-  hSmear = (TH1D*) _hResponse -> ProjectionX("hSmear", iPrior, iPrior);
-  nSmear = hSmear -> GetEntries();
-  if (nSmear < 1)
-    xS = -1000.;
-  else
-    xS = hSmear -> GetRandom();
 
-  if (xS > _bMax)
-    xS = -1000.;
-  return xS;
+void StJetFolder::GeneratePrior() {
 
-}  // end 'Smear(Double_t)'
+  // prior function is defined on [XminPrior, last edge]
+  const Int_t    nBins = _hPrior -> GetNbinsX();
+  const Double_t xLast = _hPrior -> GetBinLowEdge(nBins + 1);
+  const Double_t xLo   = XminPrior;
+  const Double_t xHi   = TMath::Min(_uMax, xLast);
+
+  // integral of prior over each bin
+  vector<Double_t> prob(nBins, 0.);
+  Double_t         total = 0.;
+  for (Int_t iBin = 0; iBin < nBins; iBin++) {
+    const Double_t bLo = TMath::Max(_hPrior -> GetBinLowEdge(iBin + 1), xLo);
+    const Double_t bHi = TMath::Min(_hPrior -> GetBinLowEdge(iBin + 2), xHi);
+    if (bHi <= bLo) continue;
+
+    const Double_t area = IntegratePrior(bLo, bHi);
+    if (area > 0.) prob[iBin] = area;
+    total += prob[iBin];
+  }
+  if (total > 0.) {
+    for (Int_t iBin = 0; iBin < nBins; iBin++) {
+      prob[iBin] /= total;
+    }
+  }
+
+  _hPrior -> Reset("ICE");
+  if (total <= 0.) return;
+
+
+  // expected counts for nMC draws: no sampling, errors are the expected
+  // statistical ones so chi2's stay comparable with the sampled prior
+  if (_priorMode == 0) {
+    for (Int_t iBin = 0; iBin < nBins; iBin++) {
+      const Double_t nExp = _nMC * prob[iBin];
+      _hPrior -> SetBinContent(iBin + 1, nExp);
+      _hPrior -> SetBinError(iBin + 1, TMath::Sqrt(nExp));
+    }
+    _hPrior -> SetEntries(_nMC);
+    return;
+  }
+
+
+  // otherwise draw nMC bins by inverse cdf, in batches
+  vector<Double_t> cdf(nBins + 1, 0.);
+  for (Int_t iBin = 0; iBin < nBins; iBin++) {
+    cdf[iBin + 1] = cdf[iBin] + prob[iBin];
+  }
+  cdf[nBins] = 1.;
+
+  // prior draws have their own stream
+  TRandom3         rando(StreamSeed(StreamPrior, 0));
+  vector<Double_t> counts(nBins, 0.);
+  Double_t         ran[NbatchMC];
+  for (Int_t iMC = 0; iMC < _nMC; iMC += NbatchMC) {
+    const Int_t nDraw = TMath::Min(NbatchMC, _nMC - iMC);
+    rando.RndmArray(nDraw, ran);
+    for (Int_t iDraw = 0; iDraw < nDraw; iDraw++) {
+      Long64_t iBin = TMath::BinarySearch((Long64_t) (nBins + 1), &cdf[0], ran[iDraw]);
+      if (iBin >= nBins) iBin = nBins - 1;
+      while ((iBin > 0) && (prob[iBin] <= 0.)) iBin--;
+      counts[iBin] += 1.;
+    }
+  }
+
+  for (Int_t iBin = 0; iBin < nBins; iBin++) {
+    _hPrior -> SetBinContent(iBin + 1, counts[iBin]);
+    _hPrior -> SetBinError(iBin + 1, TMath::Sqrt(counts[iBin]));
+  }
+  _hPrior -> SetEntries(_nMC);
+
+}  // end 'GeneratePrior()'
+
+
+Double_t StJetFolder::IntegratePrior(const Double_t xLo, const Double_t xHi) {
+
+  // exponential and power law analytically
+  const Double_t b = _bPrior;
+  const Double_t t = _tPrior;
+  switch (_prior) {
+    case 3:
+      return b * t * (exp(-1. * xLo / t) - exp(-1. * xHi / t));
+    case 4:
+      if (t == 1.)
+        return b * log(xHi / xLo);
+      else
+        return b * (pow(xHi, 1. - t) - pow(xLo, 1. - t)) / (1. - t);
+  }
+
+
+  // levy and tsallis by gauss-legendre quadrature
+  static const Double_t xGaus[NgausPts] = {-0.9602898564975363, -0.7966664774136267, -0.5255324099163290, -0.1834346424956498, 0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363};
+  static const Double_t wGaus[NgausPts] = {0.1012285362903763, 0.2223810344533745, 0.3137066458778873, 0.3626837833783620, 0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763};
+
+  const Double_t pLevy[4]    = {_bPrior, _mPrior, _nPrior, _tPrior};
+  const Double_t pTsallis[3] = {_bPrior, _nPrior, _tPrior};
+  const Double_t step        = (xHi - xLo) / NgausSub;
+
+  Double_t integral = 0.;
+  for (Int_t iSub = 0; iSub < NgausSub; iSub++) {
+    const Double_t mid  = xLo + ((iSub + 0.5) * step);
+    const Double_t half = 0.5 * step;
+    for (Int_t iPt = 0; iPt < NgausPts; iPt++) {
+      const Double_t x = mid + (half * xGaus[iPt]);
+      Double_t       f = 0.;
+      if (_prior == 1)
+        f = Levy(&x, pLevy);
+      else
+        f = Tsallis(&x, pTsallis);
+      if (f == f) integral += half * wGaus[iPt] * f;
+    }
+  }
+  return integral;
+
+}  // end 'IntegratePrior(Double_t, Double_t)'
 
 
 Double_t StJetFolder::CalculateChi2(const TH1D *hA, TH1D *hB) {
@@ -242,6 +392,28 @@ Double_t StJetFolder::CalculateChi2(const TH1D *hA, TH1D *hB) {
 }  // end 'CalculateChi2(TH1D*, TH1D*)'
 
 
+TH1D* StJetFolder::GetSweepErrors(RooUnfoldBayes *bay) {
+
+  // same as 'RooUnfoldErrors::UnfoldingError()' (errors from the
+  // unfolding covariance), but after '_kReg' iterations and w/o toys
+  TH1D *hErrors = (TH1D*) bay -> HrecoIter(_kReg);
+  hErrors -> SetNameTitle("unferr", "Unfolding errors");
+
+  const Int_t nBins = hErrors -> GetNbinsX();
+  for (Int_t iBin = 0; iBin < nBins + 2; iBin++) {
+    const Double_t error = hErrors -> GetBinError(iBin);
+    hErrors -> SetBinContent(iBin, error);
+    hErrors -> SetBinError(iBin, 0.);
+  }
+  hErrors -> SetMarkerColor(kBlue);
+  hErrors -> SetLineColor(kBlue);
+  hErrors -> SetMarkerStyle(24);
+  hErrors -> SetMinimum(0);
+  return hErrors;
+
+}  // end 'GetSweepErrors(RooUnfoldBayes*)'
+
+
 Double_t StJetFolder::Levy(const Double_t *x, const Double_t *p) {
 
   const Double_t tau = TMath::TwoPi();
@@ -5,7 +5,7 @@
 // This class handles the unfolding of a provided spectrum.  This file
 // encapsulates various routines associated with plotting results.
 //
-// Last updated: 09.12.2018
+// Last updated: 10.17.2026
 
 
 #pragma once
@@ -225,9 +225,6 @@ void StJetFolder::CreatePlots() {
   pChi2U -> SetTextAlign(12);
   pChi2U -> AddText(x2txtU.Data());
 
-  // generate unfolding info
-  CreateUnfoldInfo();
-
 
   // create blank histograms
   const Int_t    nM   = _hMeasured -> GetNbinsX();
@@ -699,6 +696,37 @@ void StJetFolder::CreatePlots() {
 }  // end 'CreatePlots()'
 
 
+void StJetFolder::Plot(const Char_t *rFile, const Char_t *pFile) {
+
+  // makes the plots of 'Finish()' from a file written in results-only
+  // mode; they go into 'pFile', or back into 'rFile' if none is given
+  const Bool_t addDir = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+
+  TFile *fIn = new TFile(rFile, "read");
+  if (!fIn || fIn -> IsZombie()) {
+    cerr << "PANIC: couldn't open results file '" << rFile << "'!" << endl;
+    assert(fIn && !fIn -> IsZombie());
+  }
+
+  StJetFolder *folder = new StJetFolder("");
+  folder -> LoadResults(fIn);
+  fIn    -> Close();
+  delete fIn;
+
+  if (pFile && (pFile[0] != '\0'))
+    folder -> _fOut = new TFile(pFile, "recreate");
+  else
+    folder -> _fOut = new TFile(rFile, "update");
+  folder -> CreatePlots();
+  folder -> _fOut -> Close();
+  delete folder;
+
+  TH1::AddDirectory(addDir);
+
+}  // end 'Plot(Char_t*, Char_t*)'
+
+
 
 void StJetFolder::ResizeString(TString &str, const Int_t nDec) {
 
@@ -715,6 +743,17 @@ void StJetFolder::ResizeString(TString &str, const Int_t nDec) {
 }  // end 'ResizeString(TString&, Int_t)'
 
 
+TString StJetFolder::MakeName(const Char_t *base) const {
+
+  // unique per folder, so several folders can coexist
+  TString name(base);
+  name += "_";
+  name += _id;
+  return name;
+
+}  // end 'MakeName(Char_t*)'
+
+
 void StJetFolder::DrawHistogram(TH1 *h, const Char_t *option, const Int_t mColor, const Int_t lColor, const Int_t fColor, const Int_t mStyle, const Int_t lStyle, const Int_t fStyle, const Double_t mSize) {
 
   h -> SetMarkerColor(mColor);
@@ -5,7 +5,7 @@
 // This class handles the unfolding of a provided spectrum.  This file
 // encapsulates various internal routines (e.g. printing error messages).
 //
-// Last updated: 07.15.2018
+// Last updated: 10.17.2026
 
 
 #pragma once
@@ -18,9 +18,14 @@ void StJetFolder::PrintInfo(const Int_t code) {
 
   switch (code) {
     case 0:
-      cout << "\n  Folder created!\n"
-           << "    Writing to '" << _fOut -> GetName() << "'"
-           << endl;
+      if (_fOut)
+        cout << "\n  Folder created!\n"
+             << "    Writing to '" << _fOut -> GetName() << "'"
+             << endl;
+      else
+        cout << "\n  Folder created!\n"
+             << "    No output file (results only)"
+             << endl;
       break;
     case 1:
       cout << "    Spectra grabbed..." << endl;
@@ -36,7 +41,8 @@ void StJetFolder::PrintInfo(const Int_t code) {
       cout << "    Unfolding parameters set...\n"
            << "      method = " << _method << ", k = " << _kReg << "\n"
            << "      nMc = " << _nMC << ", nToy = " << _nToy << "\n"
-           << "      uMax = " << _uMax << ", bMax = " << _bMax
+           << "      uMax = " << _uMax << ", bMax = " << _bMax << "\n"
+           << "      backfold mode = " << _backMode
            << endl;
       break;
     case 4:
@@ -70,6 +76,21 @@ void StJetFolder::PrintInfo(const Int_t code) {
     case 12:
       cout << "  Folding finished!\n" << endl;
       break;
+    case 13:
+      cout << "      Backfolding with " << _nThread << " threads (seed = " << _seed << ")..." << endl;
+      break;
+    case 14:
+      cout << "      Generating response with " << _nThread << " threads (seed = " << _seed << ")..." << endl;
+      break;
+    case 15:
+      cout << "    Results only (no plots); saving..." << endl;
+      break;
+    case 16:
+      cout << "    Spectra and response read from input cache..." << endl;
+      break;
+    case 17:
+      cout << "    Spectra and response written to input cache..." << endl;
+      break;
   }
 
 }  // end 'PrintInfo(Int_t)'
@@ -117,6 +138,15 @@ void StJetFolder::PrintError(const Int_t code) {
     case 12:
       cerr << "PANIC: trying to take ratio of 2 histograms with different dimensions!" << endl;
       break;
+    case 13:
+      cerr << "PANIC: sweep folder hasn't done enough bayesian iterations!" << endl;
+      break;
+    case 14:
+      cerr << "PANIC: couldn't grab results to plot!" << endl;
+      break;
+    case 15:
+      cerr << "WARNING: couldn't write input cache!" << endl;
+      break;
   }
 
 }  // end 'PrintInfo(Int_t)'
@@ -124,6 +154,10 @@ void StJetFolder::PrintError(const Int_t code) {
 
 void StJetFolder::InitializePriors() {
 
+  // prior and smeared spectra are regenerated
+  OwnInput(0);
+  OwnInput(1);
+
   // for normalization
   TH1D *hSmearNorm = (TH1D*) _hMeasured -> Clone();
   TH1D *hAfterEff  = (TH1D*) _hMeasured -> Clone();
@@ -144,36 +178,7 @@ void StJetFolder::InitializePriors() {
 
 
   // create particle-level prior
-  switch (_prior) {
-    case 1:
-      _hPrior -> Reset("ICE");
-      for (UInt_t iMC = 0; iMC < _nMC; iMC++) {
-        const Double_t l = _fLevy -> GetRandom(XminPrior, _uMax);
-        _hPrior -> Fill(l);
-      }
-      break;
-    case 2:
-      _hPrior -> Reset("ICE");
-      for (UInt_t iMC = 0; iMC < _nMC; iMC++) {
-        const Double_t t = _fTsallis -> GetRandom(XminPrior, _uMax);
-        _hPrior -> Fill(t);
-      }
-      break;
-    case 3:
-      _hPrior -> Reset("ICE");
-      for (UInt_t iMC = 0; iMC < _nMC; iMC++) { 
-        const Double_t e = _fExponential -> GetRandom(XminPrior, _uMax);
-        _hPrior -> Fill(e);
-      }
-      break;
-    case 4:
-      _hPrior -> Reset("ICE");
-      for (UInt_t iMC = 0; iMC < _nMC; iMC++) {
-        const Double_t p = _fPowerLaw -> GetRandom(XminPrior, _uMax);
-        _hPrior -> Fill(p);
-      }
-      break;
-  }
+  GeneratePrior();
 
   const Double_t iPar   = hAfterEff -> Integral();
   const Double_t iParMC = _hPrior   -> Integral();
@@ -191,38 +196,13 @@ void StJetFolder::InitializePriors() {
   }
 
 
-  // create detector-level prior and response
+  // create detector-level prior and response (on '_nThread' threads)
   _hSmeared -> Reset("ICE");
-  for (Int_t iMC = 0; iMC < _nMC; iMC++) {
-    const Double_t p = _hPrior -> GetRandom();
-    const Double_t s = Smear(p);
-    const UInt_t   e = ApplyEff(p);
-    if ((s > -1000.) && (e == 1)) {
-      _hSmeared      -> Fill(s);
-      _hResponseDiff -> Fill(s, p);
-      hDetEffDif     -> Fill(p);
-    }
-    hSmearNorm -> Fill(p);
-    hParEffDif -> Fill(p);
-  }
+  ResponseParallel(hDetEffDif, hParEffDif, hSmearNorm);
   _hEfficiencyDiff -> Divide(hDetEffDif, hParEffDif, 1., 1.);
 
   // normalize response
-  const UInt_t nXbins = _hResponseDiff -> GetNbinsX();
-  const UInt_t nYbins = _hResponseDiff -> GetNbinsY();
-  for (UInt_t iBinY = 0; iBinY < nYbins; iBinY++) {
-    const Double_t binNorm = _hResponseDiff -> Integral(1, nXbins, iBinY, iBinY);
-    if (binNorm != 0.) {
-      for (UInt_t iBinX = 0; iBinX < nXbins; iBinX++) {
-        const Double_t binVal = _hResponseDiff -> GetBinContent(iBinX, iBinY);
-        const Double_t binErr = _hResponseDiff -> GetBinError(iBinX, iBinY);
-        const Double_t newVal = (binVal / binNorm);
-        const Double_t newErr = (binErr / binNorm);
-        _hResponseDiff -> SetBinContent(iBinX, iBinY, newVal);
-        _hResponseDiff -> SetBinError(iBinX, iBinY, newErr);
-      }  // end x loop
-    }
-  }  // end y loop
+  NormalizeResponse();
 
 
   const Double_t iNorm  = _hPrior    -> Integral();
@@ -230,9 +210,62 @@ void StJetFolder::InitializePriors() {
   const Double_t scaleS = iNorm / iDetMC;
   if (iNorm > 0.) _hSmeared -> Scale(scaleS);
 
+  delete hSmearNorm;
+  delete hAfterEff;
+  delete hParEffDif;
+  delete hDetEffDif;
+
 }  // end 'InitializePriors()'
 
 
+void StJetFolder::NormalizeResponse() {
+
+  // normalize each particle-level row of the response to unity,
+  // working directly on the content and sumw2 arrays (the errors
+  // have to be scaled too, so make sure sumw2 exists)
+  if (_hResponseDiff -> GetSumw2N() == 0) _hResponseDiff -> Sumw2();
+
+  const Int_t nX    = _hResponseDiff -> GetNbinsX();
+  const Int_t nY    = _hResponseDiff -> GetNbinsY();
+  const Int_t nRow  = nX + 2;
+  Double_t    *val  = _hResponseDiff -> GetArray();
+  Double_t    *err2 = _hResponseDiff -> GetSumw2() -> GetArray();
+
+  for (Int_t iBinY = 1; iBinY < (nY + 1); iBinY++) {
+    Double_t *row  = val + (nRow * iBinY);
+    Double_t  norm = 0.;
+    for (Int_t iBinX = 1; iBinX < (nX + 1); iBinX++) {
+      norm += row[iBinX];
+    }
+    if (norm == 0.) continue;
+
+    const Double_t scale  = 1. / norm;
+    const Double_t scale2 = scale * scale;
+    Double_t *rowErr2 = err2 + (nRow * iBinY);
+    for (Int_t iBinX = 1; iBinX < (nX + 1); iBinX++) {
+      row[iBinX]     *= scale;
+      rowErr2[iBinX] *= scale2;
+    }
+  }  // end y loop
+
+}  // end 'NormalizeResponse()'
+
+
+void StJetFolder::CacheResponse() {
+
+  // fill the response's cached vectors and matrices now, so that
+  // folders sharing it only ever read them
+  _response -> Vmeasured();
+  _response -> Emeasured();
+  _response -> Vfakes();
+  _response -> Vtruth();
+  _response -> Etruth();
+  _response -> Mresponse();
+  _response -> Eresponse();
+
+}  // end 'CacheResponse()'
+
+
 Bool_t StJetFolder::CheckFlags() {
 
   // check spectra
@@ -277,4 +310,19 @@ Bool_t StJetFolder::CheckFlags() {
 
 }  // end 'CheckFlags()'
 
+
+Bool_t StJetFolder::HasInputs() const {
+
+  // spectra and info (i.e. everything but the parameters)
+  Bool_t inputsOK = true;
+  for (Int_t i = 0; i < 8; i++) {
+    if (!_flag[i]) {
+      inputsOK = false;
+      break;
+    }
+  }
+  return inputsOK;
+
+}  // end 'HasInputs()'
+
 // End ------------------------------------------------------------------------
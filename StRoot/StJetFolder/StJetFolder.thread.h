@@ -0,0 +1,308 @@
+// 'StJetFolder.thread.h'
+// Derek Anderson
+// 10.17.2026
+//
+// This class handles the unfolding of a provided spectrum.  This file
+// encapsulates the multi-threaded routines (backfolding and response
+// regeneration) and the seeding of every random stream.  Work is
+// split into chunks of 'NchunkMC' draws; each chunk draws from its own
+// TRandom3 stream (keyed by '_seed', the configuration, the routine
+// and the chunk index) into private bin counts.  Chunks run
+// in waves of one chunk per thread, and the (integer) counts are summed
+// in chunk order.  Results are therefore reproducible for a given seed,
+// whatever the no. of threads, and any chunk can be re-run on its own.
+//
+// Last updated: 10.17.2026
+
+
+#pragma once
+
+using namespace std;
+
+
+
+// shared state for parallel backfolding
+struct StJetBackfoldJob {
+  const StJetFolder         *folder;
+  const StJetSampler        *unfolded;
+  Int_t                     iFirst;   // first chunk of this wave
+  vector<Double_t>          uEdges;
+  vector<Double_t>          bEdges;
+  vector< vector<Double_t> > uCounts;
+  vector< vector<Double_t> > bCounts;
+};
+
+// shared state for parallel response regeneration
+struct StJetResponseJob {
+  const StJetFolder         *folder;
+  const StJetSampler        *prior;
+  Int_t                     iFirst;   // first chunk of this wave
+  vector<Double_t>          pEdges;   // particle-level efficiency
+  vector<Double_t>          efficiency;
+  vector<Double_t>          sEdges;   // smeared
+  vector<Double_t>          xEdges;   // response (detector)
+  vector<Double_t>          yEdges;   // response (particle)
+  vector<Double_t>          dEdges;   // detector-level efficiency
+  vector<Double_t>          nEdges;   // smearing normalization
+  vector<Double_t>          aEdges;   // particle-level efficiency
+  vector< vector<Double_t> > sCounts;
+  vector< vector<Double_t> > rCounts;
+  vector< vector<Double_t> > dCounts;
+  vector< vector<Double_t> > nCounts;
+  vector< vector<Double_t> > aCounts;
+};
+
+
+
+void StJetFolder::BackfoldParallel() {
+
+  PrintInfo(13);
+
+  // sample unfolded spectrum from a table instead of 'GetRandom()'
+  StJetSampler *unfolded = new StJetSampler();
+  unfolded -> Build(_hUnfolded);
+
+  StJetBackfoldJob job;
+  job.folder   = this;
+  job.unfolded = unfolded;
+  GetBinEdges(_hNormalize -> GetXaxis(), job.uEdges);
+  GetBinEdges(_hBackfolded -> GetXaxis(), job.bEdges);
+
+  // private accumulators (incl. under- and overflow)
+  const Int_t      nU     = _hNormalize  -> GetNbinsX() + 2;
+  const Int_t      nB     = _hBackfolded -> GetNbinsX() + 2;
+  const Int_t      nChunk = (_nMC + NchunkMC - 1) / NchunkMC;
+  vector<Double_t> uTotal(nU, 0.);
+  vector<Double_t> bTotal(nB, 0.);
+
+  // one chunk per thread at a time, merged in chunk order
+  for (job.iFirst = 0; job.iFirst < nChunk; job.iFirst += _nThread) {
+    const Int_t nTask = TMath::Min(_nThread, nChunk - job.iFirst);
+    job.uCounts.assign(nTask, vector<Double_t>(nU, 0.));
+    job.bCounts.assign(nTask, vector<Double_t>(nB, 0.));
+    RooUnfoldParallel::Run(nTask, BackfoldTask, &job, _nThread);
+    AddCounts(uTotal, job.uCounts);
+    AddCounts(bTotal, job.bCounts);
+  }
+  FillFromCounts(_hNormalize, uTotal);
+  FillFromCounts(_hBackfolded, bTotal);
+
+  delete unfolded;
+
+}  // end 'BackfoldParallel()'
+
+
+void StJetFolder::BackfoldTask(Int_t iTask, void *arg) {
+
+  StJetBackfoldJob  *job    = (StJetBackfoldJob*) arg;
+  const StJetFolder *folder = job -> folder;
+
+  // last chunk takes the remainder
+  const Int_t iChunk = job -> iFirst + iTask;
+  const Int_t nDraw  = TMath::Min(NchunkMC, folder -> _nMC - (iChunk * NchunkMC));
+
+  TRandom3         rando(folder -> StreamSeed(StreamBackfold, iChunk));
+  vector<Double_t> &uCounts = job -> uCounts[iTask];
+  vector<Double_t> &bCounts = job -> bCounts[iTask];
+
+  // monte-carlo loop
+  for (Int_t i = 0; i < nDraw; i++) {
+    const Double_t u = job -> unfolded -> Sample(&rando);
+    if (u == NoSample) break;
+
+    const Double_t b = folder -> _smearKernel -> SampleY(u, &rando);
+    uCounts[FindBin(job -> uEdges, u)] += 1.;
+    if (b > NoSample) bCounts[FindBin(job -> bEdges, b)] += 1.;
+  }
+
+}  // end 'BackfoldTask(Int_t, void*)'
+
+
+void StJetFolder::ResponseParallel(TH1D *hDetEffDif, TH1D *hParEffDif, TH1D *hSmearNorm) {
+
+  PrintInfo(14);
+
+  // sample prior from a table instead of 'GetRandom()'
+  StJetSampler *prior = new StJetSampler();
+  prior -> Build(_hPrior);
+
+  StJetResponseJob job;
+  job.folder = this;
+  job.prior  = prior;
+  GetBinEdges(_hEfficiency -> GetXaxis(), job.pEdges);
+  GetBinEdges(_hSmeared -> GetXaxis(), job.sEdges);
+  GetBinEdges(_hResponseDiff -> GetXaxis(), job.xEdges);
+  GetBinEdges(_hResponseDiff -> GetYaxis(), job.yEdges);
+  GetBinEdges(hDetEffDif -> GetXaxis(), job.dEdges);
+  GetBinEdges(hSmearNorm -> GetXaxis(), job.nEdges);
+  GetBinEdges(hParEffDif -> GetXaxis(), job.aEdges);
+
+  // efficiency look-up (incl. under- and overflow)
+  const Int_t nE = _hEfficiency -> GetNbinsX() + 2;
+  job.efficiency.resize(nE);
+  for (Int_t iBin = 0; iBin < nE; iBin++) {
+    job.efficiency[iBin] = _hEfficiency -> GetBinContent(iBin);
+  }
+
+  // private accumulators (incl. under- and overflow)
+  const Int_t nS = _hSmeared  -> GetNbinsX() + 2;
+  const Int_t nR = (_hResponseDiff -> GetNbinsX() + 2) * (_hResponseDiff -> GetNbinsY() + 2);
+  const Int_t nD = hDetEffDif -> GetNbinsX() + 2;
+  const Int_t nN = hSmearNorm -> GetNbinsX() + 2;
+  const Int_t nA = hParEffDif -> GetNbinsX() + 2;
+  const Int_t nChunk = (_nMC + NchunkMC - 1) / NchunkMC;
+  vector<Double_t> sTotal(nS, 0.);
+  vector<Double_t> rTotal(nR, 0.);
+  vector<Double_t> dTotal(nD, 0.);
+  vector<Double_t> nTotal(nN, 0.);
+  vector<Double_t> aTotal(nA, 0.);
+
+  // one chunk per thread at a time, merged in chunk order
+  for (job.iFirst = 0; job.iFirst < nChunk; job.iFirst += _nThread) {
+    const Int_t nTask = TMath::Min(_nThread, nChunk - job.iFirst);
+    job.sCounts.assign(nTask, vector<Double_t>(nS, 0.));
+    job.rCounts.assign(nTask, vector<Double_t>(nR, 0.));
+    job.dCounts.assign(nTask, vector<Double_t>(nD, 0.));
+    job.nCounts.assign(nTask, vector<Double_t>(nN, 0.));
+    job.aCounts.assign(nTask, vector<Double_t>(nA, 0.));
+    RooUnfoldParallel::Run(nTask, ResponseTask, &job, _nThread);
+    AddCounts(sTotal, job.sCounts);
+    AddCounts(rTotal, job.rCounts);
+    AddCounts(dTotal, job.dCounts);
+    AddCounts(nTotal, job.nCounts);
+    AddCounts(aTotal, job.aCounts);
+  }
+  FillFromCounts(_hSmeared, sTotal);
+  FillFromCounts(_hResponseDiff, rTotal);
+  FillFromCounts(hDetEffDif, dTotal);
+  FillFromCounts(hSmearNorm, nTotal);
+  FillFromCounts(hParEffDif, aTotal);
+
+  delete prior;
+
+}  // end 'ResponseParallel(TH1D*, TH1D*, TH1D*)'
+
+
+void StJetFolder::ResponseTask(Int_t iTask, void *arg) {
+
+  StJetResponseJob  *job    = (StJetResponseJob*) arg;
+  const StJetFolder *folder = job -> folder;
+
+  // last chunk takes the remainder
+  const Int_t iChunk = job -> iFirst + iTask;
+  const Int_t nDraw  = TMath::Min(NchunkMC, folder -> _nMC - (iChunk * NchunkMC));
+
+  TRandom3         rando(folder -> StreamSeed(StreamResponse, iChunk));
+  vector<Double_t> &sCounts = job -> sCounts[iTask];
+  vector<Double_t> &rCounts = job -> rCounts[iTask];
+  vector<Double_t> &dCounts = job -> dCounts[iTask];
+  vector<Double_t> &nCounts = job -> nCounts[iTask];
+  vector<Double_t> &aCounts = job -> aCounts[iTask];
+  const Int_t      nRx      = job -> xEdges.size() + 1;
+
+  // monte-carlo loop
+  for (Int_t i = 0; i < nDraw; i++) {
+    const Double_t p = job -> prior -> Sample(&rando);
+    if (p == NoSample) break;
+
+    const Double_t s   = folder -> _smearKernel -> SampleY(p, &rando);
+    const Double_t eff = job -> efficiency[FindBin(job -> pEdges, p)];
+    const Double_t ran = rando.Rndm();
+    if ((s > NoSample) && (ran <= eff)) {
+      const Int_t iRx = FindBin(job -> xEdges, s);
+      const Int_t iRy = FindBin(job -> yEdges, p);
+      sCounts[FindBin(job -> sEdges, s)] += 1.;
+      rCounts[iRx + (nRx * iRy)]         += 1.;
+      dCounts[FindBin(job -> dEdges, p)] += 1.;
+    }
+    nCounts[FindBin(job -> nEdges, p)] += 1.;
+    aCounts[FindBin(job -> aEdges, p)] += 1.;
+  }
+
+}  // end 'ResponseTask(Int_t, void*)'
+
+
+Int_t StJetFolder::FindBin(const vector<Double_t> &edges, const Double_t x) {
+
+  // same convention as TAxis::FindBin(): 0 = underflow, nBins + 1 = overflow
+  const Long64_t iEdge = TMath::BinarySearch((Long64_t) edges.size(), &edges[0], x);
+  return (Int_t) (iEdge + 1);
+
+}  // end 'FindBin(vector<Double_t>&, Double_t)'
+
+
+void StJetFolder::GetBinEdges(const TAxis *axis, vector<Double_t> &edges) {
+
+  const Int_t nEdges = axis -> GetNbins() + 1;
+  edges.resize(nEdges);
+  for (Int_t iEdge = 0; iEdge < nEdges; iEdge++) {
+    edges[iEdge] = axis -> GetBinLowEdge(iEdge + 1);
+  }
+
+}  // end 'GetBinEdges(TAxis*, vector<Double_t>&)'
+
+
+void StJetFolder::AddCounts(vector<Double_t> &total, const vector< vector<Double_t> > &counts) {
+
+  // sum chunks in order; indices are global bin numbers
+  const Int_t nCells = total.size();
+  for (UInt_t iChunk = 0; iChunk < counts.size(); iChunk++) {
+    for (Int_t iCell = 0; iCell < nCells; iCell++) {
+      total[iCell] += counts[iChunk][iCell];
+    }
+  }
+
+}  // end 'AddCounts(vector<Double_t>&, vector<vector<Double_t>>&)'
+
+
+void StJetFolder::FillFromCounts(TH1 *h, const vector<Double_t> &total) {
+
+  const Int_t nCells  = total.size();
+  Double_t    entries = 0.;
+  for (Int_t iCell = 0; iCell < nCells; iCell++) {
+    h -> SetBinContent(iCell, total[iCell]);
+    h -> SetBinError(iCell, TMath::Sqrt(total[iCell]));
+    entries += total[iCell];
+  }
+  h -> SetEntries(entries);
+
+}  // end 'FillFromCounts(TH1*, vector<Double_t>&)'
+
+
+UInt_t StJetFolder::PriorKey() const {
+
+  // key of the prior parameters (snprintf, unlike 'Form()', is safe
+  // to call from several threads)
+  Char_t label[256];
+  snprintf(label, sizeof(label), "p%d:%d b%.17g m%.17g n%.17g t%.17g", _prior, _priorMode, _bPrior, _mPrior, _nPrior, _tPrior);
+  return RooUnfoldParallel::Key(label);
+
+}  // end 'PriorKey()'
+
+
+UInt_t StJetFolder::ConfigKey() const {
+
+  // key of the prior and unfolding parameters
+  Char_t label[256];
+  snprintf(label, sizeof(label), "%u m%d k%d b%d", PriorKey(), _method, _kReg, _backMode);
+  return RooUnfoldParallel::Key(label);
+
+}  // end 'ConfigKey()'
+
+
+UInt_t StJetFolder::StreamSeed(const UInt_t stream, const UInt_t index) const {
+
+  // seed of one chunk (or toy) of a stream.  Streams of different
+  // configurations are independent, unless '_commonRandom' is set;
+  // the prior and response streams are keyed by the prior only,
+  // since the folders with that prior share them (see 'SetPrepared()')
+  UInt_t key = 0;
+  if (!_commonRandom) {
+    const Bool_t isPrior = ((stream == StreamPrior) || (stream == StreamResponse));
+    key = isPrior ? PriorKey() : ConfigKey();
+  }
+  return RooUnfoldParallel::Seed(RooUnfoldParallel::Seed(_seed, key, stream), index);
+
+}  // end 'StreamSeed(UInt_t, UInt_t)'
+
+// End ------------------------------------------------------------------------
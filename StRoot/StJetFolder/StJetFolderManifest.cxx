@@ -0,0 +1,42 @@
+// 'StJetFolderManifest.cxx'
+// Derek Anderson
+// 10.17.2026
+//
+// One description of all the inputs of a 'StJetFolder'.  See
+// 'StJetFolderManifest.h' for details.
+//
+// Last updated: 10.17.2026
+
+
+#include "StJetFolderManifest.h"
+
+ClassImp(StJetFolderManifest)
+
+using namespace std;
+
+
+
+StJetFolderManifest::StJetFolderManifest() {
+
+  pFile    = "";
+  pName    = "";
+  sFile    = "";
+  sName    = "";
+  mFile    = "";
+  mName    = "";
+  rFile    = "";
+  rName    = "";
+  eFile    = "";
+  eName    = "";
+  smooth   = false;
+  noErrors = false;
+  cacheDir = "";
+
+}  // end 'StJetFolderManifest()'
+
+
+StJetFolderManifest::~StJetFolderManifest() {
+
+}  // end '~StJetFolderManifest()'
+
+// End ------------------------------------------------------------------------
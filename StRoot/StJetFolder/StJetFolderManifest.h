@@ -0,0 +1,58 @@
+// 'StJetFolderManifest.h'
+// Derek Anderson
+// 10.17.2026
+//
+// One description of all the inputs of a 'StJetFolder' (or of a
+// 'StJetFolderSession'): the file and key of each spectrum, the
+// efficiency options and, optionally, a directory for the binary
+// input cache (see 'StJetFolder.cache.h').  'LoadInputs(manifest)'
+// opens each distinct file once, reads all of its keys in one pass
+// and closes it again; the folder then owns detached copies of the
+// histograms, so no 'TFile' (or its directories) is left behind.
+//
+// Last updated: 10.17.2026
+
+
+#ifndef StJetFolderManifest_h
+#define StJetFolderManifest_h
+
+// ROOT includes
+#include "TString.h"
+
+using namespace std;
+
+
+
+class StJetFolderManifest {
+
+public:
+
+  StJetFolderManifest();
+  virtual ~StJetFolderManifest();
+
+  // spectra (file and key)
+  TString pFile;
+  TString pName;
+  TString sFile;
+  TString sName;
+  TString mFile;
+  TString mName;
+  TString rFile;
+  TString rName;
+  TString eFile;
+  TString eName;
+  // efficiency options
+  Bool_t  smooth;
+  Bool_t  noErrors;
+  // input cache directory (empty = no cache)
+  TString cacheDir;
+
+
+  ClassDef(StJetFolderManifest, 1)
+
+};
+
+
+#endif
+
+// End ------------------------------------------------------------------------
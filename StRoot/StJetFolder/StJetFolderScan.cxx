@@ -0,0 +1,521 @@
+// 'StJetFolderScan.cxx'
+// Derek Anderson
+// 10.17.2026
+//
+// Scans a grid of prior / method / regularization parameters.  See
+// 'StJetFolderScan.h' for details.
+//
+// Last updated: 10.17.2026
+
+
+#include "TMutex.h"
+#include "TDatime.h"
+#include "StJetFolderScan.h"
+
+ClassImp(StJetFolderScan)
+
+using namespace std;
+
+
+// shared state for a parallel scan
+struct StJetScanJob {
+  vector<StJetFolder*>    folders;
+  vector<Int_t>           heads;    // folders which build kernel / priors / response
+  vector<Int_t>           headOf;   // folder each folder shares those with
+  vector< vector<Int_t> > units;    // folders folded together (bayes: most iterations first)
+  vector<Int_t>           users;    // folders still using each head
+  vector<TString>         outputs;
+  vector<Double_t>        chi2u;
+  vector<Double_t>        chi2b;
+  TMutex                  lock;     // guards writing out / deleting folders
+};
+
+
+
+StJetFolderScan::StJetFolderScan(StJetFolderSession *session, const Char_t *oBase) {
+
+  _session  = session;
+  _oBase    = oBase;
+  _nThread  = 1;
+  _chi2best = 999.;
+  _bestFile = "";
+  for (Int_t iMethod = 0; iMethod < Nmethod; iMethod++) {
+    _kMin[iMethod] = KdefMin;
+    _kMax[iMethod] = KdefMax;
+  }
+  _kMin[1] = KbayesMin;
+  _kMax[1] = KbayesMax;
+  _kMin[2] = KsvdMin;
+  _kMax[2] = KsvdMax;
+
+}  // end 'StJetFolderScan(StJetFolderSession*, Char_t*)'
+
+
+StJetFolderScan::~StJetFolderScan() {
+
+}  // end '~StJetFolderScan()'
+
+
+void StJetFolderScan::SetDefaults(const StJetFolderConfig &config) {
+
+  // parameters which aren't scanned
+  _defaults = config;
+
+}  // end 'SetDefaults(StJetFolderConfig&)'
+
+
+void StJetFolderScan::SetPriors(const Int_t nP, const Int_t *P) {
+
+  _priors.assign(P, P + nP);
+
+}  // end 'SetPriors(Int_t, Int_t*)'
+
+
+void StJetFolderScan::SetPriorShapes(const Int_t nN, const Double_t *N, const Int_t nT, const Double_t *T) {
+
+  _nPriors.assign(N, N + nN);
+  _tPriors.assign(T, T + nT);
+
+}  // end 'SetPriorShapes(Int_t, Double_t*, Int_t, Double_t*)'
+
+
+void StJetFolderScan::SetMethods(const Int_t nM, const Int_t *M) {
+
+  _methods.assign(M, M + nM);
+
+}  // end 'SetMethods(Int_t, Int_t*)'
+
+
+void StJetFolderScan::SetRegularization(const Int_t nK, const Int_t *K) {
+
+  _kRegs.assign(K, K + nK);
+
+}  // end 'SetRegularization(Int_t, Int_t*)'
+
+
+void StJetFolderScan::SetRegRange(const Int_t method, const Int_t kMin, const Int_t kMax) {
+
+  const Bool_t methodOK = ((method >= 0) && (method < Nmethod));
+  if (!methodOK) {
+    cerr << "PANIC: can't set k_reg range of unknown method " << method << "!" << endl;
+    assert(methodOK);
+  }
+  _kMin[method] = kMin;
+  _kMax[method] = kMax;
+
+}  // end 'SetRegRange(Int_t, Int_t, Int_t)'
+
+
+void StJetFolderScan::SetThreads(const Int_t nThread) {
+
+  // threads used for the scan (see 'StJetFolderConfig' for the
+  // threads used inside each folder)
+  _nThread = (nThread > 1) ? nThread : 1;
+
+}  // end 'SetThreads(Int_t)'
+
+
+void StJetFolderScan::Run() {
+
+  _session -> Init();
+
+  // unset parts of the grid default to '_defaults'
+  if (_priors.empty())  _priors.push_back(_defaults.prior);
+  if (_nPriors.empty()) _nPriors.push_back(_defaults.nPrior);
+  if (_tPriors.empty()) _tPriors.push_back(_defaults.tPrior);
+  if (_methods.empty()) _methods.push_back(_defaults.method);
+  if (_kRegs.empty())   _kRegs.push_back(_defaults.kReg);
+
+  TDatime start;
+  cout << "\nStarting scan: " << start.AsString() << "\n" << endl;
+
+
+  // list configurations, prior by prior
+  vector<StJetFolderConfig> configs;
+  vector<TString>           performance;
+  vector<Int_t>             pointOf;
+  for (UInt_t p = 0; p < _priors.size(); p++) {
+    for (UInt_t n = 0; n < _nPriors.size(); n++) {
+      for (UInt_t t = 0; t < _tPriors.size(); t++) {
+
+        // don't double count priors...
+        const Bool_t isPyth   = (_priors[p] == 0);
+        const Bool_t isExpo   = (_priors[p] == 3);
+        const Bool_t isPowr   = (_priors[p] == 4);
+        const Bool_t isFirstN = (n == 0);
+        const Bool_t isFirstT = (t == 0);
+        if (isPyth && !(isFirstN && isFirstT)) continue;
+        if (isExpo && !isFirstN)               continue;
+        if (isPowr && !isFirstN)               continue;
+
+        StJetFolderConfig point(_defaults);
+        point.prior  = _priors[p];
+        point.nPrior = _nPriors[n];
+        point.tPrior = _tPriors[t];
+        performance.push_back(MakePerformance(point));
+
+        // method and k loop
+        for (UInt_t m = 0; m < _methods.size(); m++) {
+          for (UInt_t k = 0; k < _kRegs.size(); k++) {
+
+            // don't double count bin-by-bin corrections, skip unreasonable kReg
+            const Bool_t isBinByBin = (_methods[m] == 3);
+            const Bool_t isFirstK   = (k == 0);
+            if (isBinByBin && !isFirstK)          continue;
+            if (!IsGoodK(_methods[m], _kRegs[k])) continue;
+
+            StJetFolderConfig config(point);
+            config.method = _methods[m];
+            config.kReg   = _kRegs[k];
+            config.output = MakeOutput(config);
+            configs.push_back(config);
+            pointOf.push_back(performance.size() - 1);
+          }  // end k loop
+        }  // end method loop
+
+      }  // end tPrior loop
+    }  // end nPrior loop
+  }  // end prior loop
+
+  const Int_t nConfig = configs.size();
+  const Int_t nPoint  = performance.size();
+  cout << "  Scanning " << nConfig << " configurations (" << nPoint << " priors) on "
+       << _nThread << " thread(s)..."
+       << endl;
+
+
+  // create folders (results only, no shared directory)
+  const Bool_t addDir = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+
+  StJetScanJob job;
+  job.chi2u.assign(nConfig, 0.);
+  job.chi2b.assign(nConfig, 0.);
+  job.users.assign(nConfig, 0);
+  for (Int_t iConfig = 0; iConfig < nConfig; iConfig++) {
+    StJetFolderConfig config(configs[iConfig]);
+    config.output = "";
+    job.folders.push_back(_session -> CreateFolder(config));
+
+    // first folder with a given prior builds it
+    Int_t iHead = iConfig;
+    for (UInt_t iPrep = 0; iPrep < job.heads.size(); iPrep++) {
+      if (_session -> IsPrepared(configs[iConfig], configs[job.heads[iPrep]])) {
+        iHead = job.heads[iPrep];
+        break;
+      }
+    }
+    if (iHead == iConfig) job.heads.push_back(iConfig);
+    job.headOf.push_back(iHead);
+    job.outputs.push_back(configs[iConfig].output);
+    job.users[iHead]++;
+  }
+
+  // build kernels / priors / responses, then share them
+  RooUnfoldParallel::Run(job.heads.size(), InitTask, &job, _nThread);
+  for (Int_t iConfig = 0; iConfig < nConfig; iConfig++) {
+    if (job.headOf[iConfig] != iConfig) job.folders[iConfig] -> SetPrepared(job.folders[job.headOf[iConfig]]);
+  }
+
+  // bayesian configurations of a prior are unfolded once (with the
+  // most iterations); everything else is on its own
+  vector<Int_t> bayesUnit(nPoint, -1);
+  for (Int_t iConfig = 0; iConfig < nConfig; iConfig++) {
+    const Bool_t isBay = (configs[iConfig].method == 1);
+    if (isBay && (bayesUnit[pointOf[iConfig]] >= 0)) {
+      vector<Int_t> &unit = job.units[bayesUnit[pointOf[iConfig]]];
+      if (configs[iConfig].kReg > configs[unit[0]].kReg) {
+        unit.insert(unit.begin(), iConfig);
+      }
+      else {
+        unit.push_back(iConfig);
+      }
+      continue;
+    }
+    if (isBay) bayesUnit[pointOf[iConfig]] = job.units.size();
+    job.units.push_back(vector<Int_t>(1, iConfig));
+  }
+
+  // the first folder of a bayesian unit keeps every iteration for
+  // the others
+  for (UInt_t iUnit = 0; iUnit < job.units.size(); iUnit++) {
+    const vector<Int_t> &unit = job.units[iUnit];
+    if (unit.size() > 1) job.folders[unit[0]] -> SetSnapshots(true);
+  }
+
+  // unfold, backfold and write out everything (folders are deleted
+  // as soon as they're written)
+  RooUnfoldParallel::Run(job.units.size(), FoldTask, &job, _nThread);
+  TH1::AddDirectory(addDir);
+
+
+  // create output stream
+  TString sStream(_oBase);
+  sStream += ".bestFiles.list";
+
+  ofstream bestFiles(sStream.Data());
+  if (!bestFiles) {
+    cerr << "PANIC: couldn't open output stream!" << endl;
+    assert(bestFiles);
+  }
+
+  // write everything out, prior by prior
+  _chi2best = 999.;
+  _bestFile = "";
+
+  Int_t iConfig = 0;
+  for (Int_t iPoint = 0; iPoint < nPoint; iPoint++) {
+
+    // create performance file
+    TFile *fChi2        = new TFile(performance[iPoint].Data(), "recreate");
+    TH1D  *hBayUnfold   = CreateChi2("hBayUnfold", "#chi^{2}(unfold, prior)", 810);
+    TH1D  *hBayBackfold = CreateChi2("hBayBackfold", "#chi^{2}(backfold, measured)", 810);
+    TH1D  *hSvdUnfold   = CreateChi2("hSvdUnfold", "#chi^{2}(unfold, prior)", 860);
+    TH1D  *hSvdBackfold = CreateChi2("hSvdBackfold", "#chi^{2}(backfold, measured)", 860);
+
+    Double_t chi2best = 999.;
+    TString  bestFile;
+    for (; (iConfig < nConfig) && (pointOf[iConfig] == iPoint); iConfig++) {
+
+      const StJetFolderConfig &config = configs[iConfig];
+      const Double_t          chi2u  = job.chi2u[iConfig];
+      const Double_t          chi2b  = job.chi2b[iConfig];
+
+      const Double_t merit   = TMath::Abs(chi2b - 1);
+      const Double_t best    = TMath::Abs(chi2best - 1);
+      const Double_t bestest = TMath::Abs(_chi2best - 1);
+      if (merit < best) {
+        chi2best = chi2b;
+        bestFile = config.output;
+      }
+      if (merit < bestest) {
+        _chi2best = chi2b;
+        _bestFile = config.output;
+      }
+
+      // record chi2
+      UInt_t iReg(0);
+      switch (config.method) {
+        case 1:
+          iReg = hBayBackfold -> FindBin(config.kReg);
+          hBayUnfold   -> SetBinContent(iReg, chi2u);
+          hBayUnfold   -> SetBinError(iReg, 0.);
+          hBayBackfold -> SetBinContent(iReg, chi2b);
+          hBayBackfold -> SetBinError(iReg, 0.);
+          break;
+        case 2:
+          iReg = hSvdBackfold -> FindBin(config.kReg);
+          hSvdUnfold   -> SetBinContent(iReg, chi2u);
+          hSvdUnfold   -> SetBinError(iReg, 0.);
+          hSvdBackfold -> SetBinContent(iReg, chi2b);
+          hSvdBackfold -> SetBinError(iReg, 0.);
+          break;
+        default:
+          break;
+      }
+
+    }  // end configuration loop
+
+    WritePerformance(fChi2, hBayUnfold, hBayBackfold, hSvdUnfold, hSvdBackfold);
+
+    // announce winner
+    TDatime endPrior;
+    cout << "\nFinished folding prior! " << endPrior.AsString() << "\n"
+         << "  Best chi2 = " << chi2best << "\n"
+         << "  Best file = " << bestFile << "\n"
+         << endl;
+
+    // stream winner (and plot only it in results-only mode)
+    bestFiles << bestFile.Data();
+    bestFiles << endl;
+    if (_defaults.resultsOnly && (bestFile.Length() > 0)) StJetFolder::Plot(bestFile.Data());
+
+  }  // end prior loop
+
+
+  // announce biggest winner
+  TDatime end;
+  cout << "\nFinished all folding! " << end.AsString() << "\n"
+       << "  Bestest chi2 = " << _chi2best << "\n"
+       << "  Bestest file = " << _bestFile << "\n"
+       << endl;
+
+}  // end 'Run()'
+
+
+Bool_t StJetFolderScan::IsGoodK(const Int_t method, const Int_t k) const {
+
+  if ((method < 0) || (method >= Nmethod)) return true;
+  return ((k >= _kMin[method]) && (k <= _kMax[method]));
+
+}  // end 'IsGoodK(Int_t, Int_t)'
+
+
+TString StJetFolderScan::MakeOutput(const StJetFolderConfig &config) const {
+
+  const Float_t Ntxt = config.nPrior * 10.;
+  const Float_t Ttxt = config.tPrior * 10.;
+
+  TString output(_oBase);
+  output += ".p";
+  output += config.prior;
+  output += "m";
+  output += config.method;
+  output += "k";
+  output += config.kReg;
+  output += "n";
+  output += Ntxt;
+  output += "t";
+  output += Ttxt;
+  output += ".root";
+  return output;
+
+}  // end 'MakeOutput(StJetFolderConfig&)'
+
+
+TString StJetFolderScan::MakePerformance(const StJetFolderConfig &config) const {
+
+  const Float_t Ntxt = config.nPrior * 10.;
+  const Float_t Ttxt = config.tPrior * 10.;
+
+  TString sChi2(_oBase);
+  sChi2 += ".p";
+  sChi2 += config.prior;
+  sChi2 += "n";
+  sChi2 += Ntxt;
+  sChi2 += "t";
+  sChi2 += Ttxt;
+  sChi2 += ".performance.root";
+  return sChi2;
+
+}  // end 'MakePerformance(StJetFolderConfig&)'
+
+
+TH1D* StJetFolderScan::CreateChi2(const Char_t *name, const Char_t *yTitle, const Int_t color) {
+
+  const Int_t nK   = _kRegs.size();
+  const Int_t kMin = _kRegs[0];
+  const Int_t kMax = _kRegs[nK - 1] + 1;
+
+  TH1D *hChi2 = new TH1D(name, "", nK, kMin, kMax);
+  hChi2 -> SetLineColor(color);
+  hChi2 -> SetMarkerColor(color);
+  hChi2 -> SetTitleFont(42);
+  hChi2 -> GetXaxis() -> SetTitle("k_{reg}");
+  hChi2 -> GetXaxis() -> SetTitleOffset(1.);
+  hChi2 -> GetXaxis() -> SetTitleFont(42);
+  hChi2 -> GetXaxis() -> SetLabelFont(42);
+  hChi2 -> GetYaxis() -> SetTitle(yTitle);
+  hChi2 -> GetYaxis() -> SetTitleFont(42);
+  hChi2 -> GetYaxis() -> SetLabelFont(42);
+  hChi2 -> Sumw2();
+  return hChi2;
+
+}  // end 'CreateChi2(Char_t*, Char_t*, Int_t)'
+
+
+void StJetFolderScan::WritePerformance(TFile *fChi2, TH1D *hBayUnfold, TH1D *hBayBackfold, TH1D *hSvdUnfold, TH1D *hSvdBackfold) {
+
+  TLegend *lUnfold   = new TLegend(0.1, 0.1, 0.3, 0.3);
+  TLegend *lBackfold = new TLegend(0.1, 0.1, 0.3, 0.3);
+  lUnfold   -> SetFillColor(0);
+  lUnfold   -> SetLineColor(0);
+  lUnfold   -> SetTextFont(42);
+  lUnfold   -> SetTextAlign(12);
+  lUnfold   -> AddEntry(hBayUnfold, "Bayes.");
+  lUnfold   -> AddEntry(hSvdUnfold, "SVD");
+  lBackfold -> SetFillColor(0);
+  lBackfold -> SetLineColor(0);
+  lBackfold -> SetTextFont(42);
+  lBackfold -> SetTextAlign(12);
+  lBackfold -> AddEntry(hBayBackfold, "Bayes.");
+  lBackfold -> AddEntry(hSvdBackfold, "SVD");
+
+  const Int_t nK   = _kRegs.size();
+  const Int_t kMin = _kRegs[0];
+  const Int_t kMax = _kRegs[nK - 1] + 1;
+
+  TLine *lOne = new TLine(kMin, 1, kMax, 1);
+  lOne  -> SetLineColor(1);
+  lOne  -> SetLineStyle(2);
+  fChi2 -> cd();
+
+  TCanvas *cUnfold   = new TCanvas("cUnfold", "", 750, 500);
+  TCanvas *cBackfold = new TCanvas("cBackfold", "", 750, 500);
+  cUnfold      -> SetGrid(0, 0);
+  cBackfold    -> SetGrid(0, 0);
+  cUnfold      -> cd();
+  hBayUnfold   -> Draw();
+  hSvdUnfold   -> Draw("same");
+  lUnfold      -> Draw();
+  lOne         -> Draw();
+  cBackfold    -> cd();
+  hBayBackfold -> Draw();
+  hSvdBackfold -> Draw("same");
+  lBackfold    -> Draw();
+  lOne         -> Draw();
+  cUnfold      -> Write();
+  cUnfold      -> Close();
+  cBackfold    -> Write();
+  cBackfold    -> Close();
+
+  // save chi2
+  fChi2        -> cd();
+  hBayUnfold   -> Write();
+  hBayBackfold -> Write();
+  hSvdUnfold   -> Write();
+  hSvdBackfold -> Write();
+  fChi2        -> Close();
+
+}  // end 'WritePerformance(TFile*, TH1D*, TH1D*, TH1D*, TH1D*)'
+
+
+void StJetFolderScan::InitTask(Int_t iTask, void *arg) {
+
+  StJetScanJob *job = (StJetScanJob*) arg;
+  job -> folders[job -> heads[iTask]] -> Init();
+
+}  // end 'InitTask(Int_t, void*)'
+
+
+void StJetFolderScan::FoldTask(Int_t iTask, void *arg) {
+
+  StJetScanJob        *job   = (StJetScanJob*) arg;
+  const vector<Int_t> &unit  = job -> units[iTask];
+  const StJetFolder   *sweep = job -> folders[unit[0]];
+  for (UInt_t iMember = 0; iMember < unit.size(); iMember++) {
+    const Int_t iConfig = unit[iMember];
+    StJetFolder *folder = job -> folders[iConfig];
+
+    // heads were initialized already
+    if (job -> headOf[iConfig] != iConfig) folder -> Init();
+    if (iMember > 0) folder -> SetSweep(sweep);
+    folder -> Unfold(job -> chi2u[iConfig]);
+    folder -> Backfold(job -> chi2b[iConfig]);
+  }
+
+  // write out the unit (the sweep last, the others take their results
+  // from it) one folder at a time, and free each folder once it and
+  // every folder sharing its kernel / response are done
+  for (Int_t iMember = ((Int_t) unit.size()) - 1; iMember >= 0; iMember--) {
+    const Int_t iConfig = unit[iMember];
+    const Int_t iHead   = job -> headOf[iConfig];
+    StJetFolder *folder = job -> folders[iConfig];
+
+    job -> lock.Lock();
+    folder -> SetOutput(job -> outputs[iConfig].Data());
+    folder -> Finish();
+    if (iHead != iConfig) {
+      delete folder;
+      job -> folders[iConfig] = 0;
+    }
+    if (--(job -> users[iHead]) == 0) {
+      delete job -> folders[iHead];
+      job -> folders[iHead] = 0;
+    }
+    job -> lock.UnLock();
+  }
+
+}  // end 'FoldTask(Int_t, void*)'
+
+// End ------------------------------------------------------------------------
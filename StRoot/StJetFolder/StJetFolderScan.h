@@ -0,0 +1,109 @@
+// 'StJetFolderScan.h'
+// Derek Anderson
+// 10.17.2026
+//
+// Scans a grid of prior / method / regularization parameters on the
+// inputs of an 'StJetFolderSession' (replaces the loops which used
+// to live in 'DoUnfolding.C').  Each point of the grid is its own
+// folder (with its own random numbers and uniquely named functions);
+// folders with the same prior share the same kernel, priors and
+// response.  The scan runs in three steps:
+//
+//   1) build one folder per prior (in parallel),
+//   2) unfold / backfold every configuration (in parallel), then
+//      write it out (one folder at a time) and delete it,
+//   3) write the chi2 vs. k_reg plots for each prior, and the list
+//      of best files (serially).
+//
+// Results therefore don't depend on the no. of scan threads.  All
+// bayesian configurations of a prior come from a single unfolding
+// with the most iterations (see 'RooUnfoldBayes::SetSnapshots()').  Like
+// the old loops, bin-by-bin is only run for the first k_reg, and the
+// exponential / power-law priors only for the first n.  If the
+// defaults are 'resultsOnly', only the best file of each prior gets
+// its plots (the rest can be plotted later, see 'PlotFolding.C').
+//
+// Last updated: 10.17.2026
+
+
+#ifndef StJetFolderScan_h
+#define StJetFolderScan_h
+
+#include <vector>
+#include <fstream>
+// user includes
+#include "StJetFolderSession.h"
+
+using namespace std;
+
+
+// global constants
+const Int_t Nmethod   = 6;
+const Int_t KdefMin   = 1;
+const Int_t KdefMax   = 1000;
+const Int_t KbayesMin = 1;
+const Int_t KbayesMax = 5;
+const Int_t KsvdMin   = 6;
+const Int_t KsvdMax   = 11;
+
+
+
+class StJetFolderScan {
+
+public:
+
+  StJetFolderScan(StJetFolderSession *session, const Char_t *oBase);
+  virtual ~StJetFolderScan();
+
+  // public methods
+  void SetDefaults(const StJetFolderConfig &config);
+  void SetPriors(const Int_t nP, const Int_t *P);
+  void SetPriorShapes(const Int_t nN, const Double_t *N, const Int_t nT, const Double_t *T);
+  void SetMethods(const Int_t nM, const Int_t *M);
+  void SetRegularization(const Int_t nK, const Int_t *K);
+  void SetRegRange(const Int_t method, const Int_t kMin, const Int_t kMax);
+  void SetThreads(const Int_t nThread);
+  void Run();
+  // public getters
+  Double_t GetBestChi2() const {return _chi2best;}
+  TString  GetBestFile() const {return _bestFile;}
+
+
+private:
+
+  // atomic members
+  Int_t    _nThread;
+  Int_t    _kMin[Nmethod];
+  Int_t    _kMax[Nmethod];
+  Double_t _chi2best;
+  // ROOT members
+  TString  _oBase;
+  TString  _bestFile;
+  // grid
+  vector<Int_t>     _priors;
+  vector<Double_t>  _nPriors;
+  vector<Double_t>  _tPriors;
+  vector<Int_t>     _methods;
+  vector<Int_t>     _kRegs;
+  StJetFolderConfig _defaults;
+  // session
+  StJetFolderSession *_session;
+
+  // private methods
+  Bool_t  IsGoodK(const Int_t method, const Int_t k) const;
+  TString MakeOutput(const StJetFolderConfig &config) const;
+  TString MakePerformance(const StJetFolderConfig &config) const;
+  TH1D*   CreateChi2(const Char_t *name, const Char_t *yTitle, const Int_t color);
+  void    WritePerformance(TFile *fChi2, TH1D *hBayUnfold, TH1D *hBayBackfold, TH1D *hSvdUnfold, TH1D *hSvdBackfold);
+  static void InitTask(Int_t iTask, void *arg);
+  static void FoldTask(Int_t iTask, void *arg);
+
+
+  ClassDef(StJetFolderScan, 1)
+
+};
+
+
+#endif
+
+// End ------------------------------------------------------------------------
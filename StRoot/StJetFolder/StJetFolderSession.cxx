@@ -0,0 +1,232 @@
+// 'StJetFolderSession.cxx'
+// Derek Anderson
+// 10.17.2026
+//
+// Runs many unfolding configurations on one set of inputs.  See
+// 'StJetFolderSession.h' for details.
+//
+// Last updated: 10.17.2026
+
+
+#include "StJetFolderSession.h"
+
+ClassImp(StJetFolderConfig)
+ClassImp(StJetFolderResult)
+ClassImp(StJetFolderSession)
+
+using namespace std;
+
+
+
+StJetFolderConfig::StJetFolderConfig() {
+
+  prior        = 0;
+  priorMode    = 0;
+  bPrior       = 1.;
+  mPrior       = Mpion;
+  nPrior       = 5.8;
+  tPrior       = 0.4;
+  method       = 1;
+  kReg         = 4;
+  nMC          = 100000;
+  nToy         = 10;
+  backMode     = 0;
+  uMax         = UdefMax;
+  bMax         = BdefMax;
+  nThread      = 1;
+  seed         = DefSeed;
+  commonRandom = false;
+  output       = "";
+  resultsOnly  = false;
+
+}  // end 'StJetFolderConfig()'
+
+
+StJetFolderConfig::~StJetFolderConfig() {
+
+}  // end '~StJetFolderConfig()'
+
+
+StJetFolderResult::StJetFolderResult() {
+
+  chi2unfold   = 0.;
+  chi2backfold = 0.;
+  hUnfolded    = 0;
+  hBackfolded  = 0;
+
+}  // end 'StJetFolderResult()'
+
+
+StJetFolderResult::~StJetFolderResult() {
+
+}  // end '~StJetFolderResult()'
+
+
+
+StJetFolderSession::StJetFolderSession(const Bool_t pearDebug) {
+
+  _pearsonDebug  = pearDebug;
+  _isInitialized = false;
+  _inputs        = new StJetFolder(0, pearDebug);
+  _prepared      = 0;
+
+}  // end 'StJetFolderSession(Bool_t)'
+
+
+StJetFolderSession::~StJetFolderSession() {
+
+  // prepared folder uses the inputs' histograms
+  delete _prepared;
+  delete _inputs;
+
+}  // end '~StJetFolderSession()'
+
+
+void StJetFolderSession::SetPrior(const Char_t *pFile, const Char_t *pName) {
+
+  _inputs -> SetPrior(pFile, pName);
+
+}  // end 'SetPrior(Char_t*, Char_t*)'
+
+
+void StJetFolderSession::SetSmeared(const Char_t *sFile, const Char_t *sName) {
+
+  _inputs -> SetSmeared(sFile, sName);
+
+}  // end 'SetSmeared(Char_t*, Char_t*)'
+
+
+void StJetFolderSession::SetMeasured(const Char_t *mFile, const Char_t *mName) {
+
+  _inputs -> SetMeasured(mFile, mName);
+
+}  // end 'SetMeasured(Char_t*, Char_t*)'
+
+
+void StJetFolderSession::SetResponse(const Char_t *rFile, const Char_t *rName) {
+
+  _inputs -> SetResponse(rFile, rName);
+
+}  // end 'SetResponse(Char_t*, Char_t*)'
+
+
+void StJetFolderSession::SetEfficiency(const Char_t *eFile, const Char_t *eName, const Bool_t doSmoothing, const Bool_t removeErrors) {
+
+  _inputs -> SetEfficiency(eFile, eName, doSmoothing, removeErrors);
+
+}  // end 'SetEfficiency(Char_t*, Char_t*, Bool_t, Bool_t)'
+
+
+void StJetFolderSession::SetEventInfo(const Int_t beam, const Double_t energy) {
+
+  _inputs -> SetEventInfo(beam, energy);
+
+}  // end 'SetEventInfo(Int_t, Double_t)'
+
+
+void StJetFolderSession::SetTriggerInfo(const Int_t trigger, const Double_t eTmin, const Double_t eTmax, const Double_t hMax) {
+
+  _inputs -> SetTriggerInfo(trigger, eTmin, eTmax, hMax);
+
+}  // end 'SetTriggerInfo(Int_t, Double_t, Double_t, Double_t)'
+
+
+void StJetFolderSession::SetJetInfo(const Int_t type, const Int_t nRM, const Double_t rJet, const Double_t aMin, const Double_t pTmin) {
+
+  _inputs -> SetJetInfo(type, nRM, rJet, aMin, pTmin);
+
+}  // end 'SetJetInfo(Int_t, Int_t, Double_t, Double_t, Double_t)'
+
+
+void StJetFolderSession::LoadInputs(const StJetFolderManifest &manifest) {
+
+  _inputs -> LoadInputs(manifest);
+
+}  // end 'LoadInputs(StJetFolderManifest&)'
+
+
+void StJetFolderSession::Init() {
+
+  const Bool_t inputOK = _inputs -> HasInputs();
+  if (!inputOK) {
+    cerr << "PANIC: session is missing some spectra or info!" << endl;
+    assert(inputOK);
+  }
+  _isInitialized = true;
+
+}  // end 'Init()'
+
+
+StJetFolderResult StJetFolderSession::Run(const StJetFolderConfig &config) {
+
+  if (!_isInitialized) Init();
+
+  // keep run's histograms out of whatever directory is current
+  const Bool_t addDir = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+
+  // reuse kernel / priors / response if possible
+  StJetFolder  *folder     = CreateFolder(config);
+  const Bool_t isPrepared = (_prepared && IsPrepared(config, _prepConfig));
+  if (isPrepared) folder -> SetPrepared(_prepared);
+  folder -> Init();
+  if (!isPrepared) {
+    delete _prepared;
+    _prepared   = folder;
+    _prepConfig = config;
+  }
+
+  StJetFolderResult result;
+  folder -> Unfold(result.chi2unfold);
+  folder -> Backfold(result.chi2backfold);
+  result.hUnfolded   = (TH1D*) folder -> GetUnfolded()   -> Clone("hUnfolded");
+  result.hBackfolded = (TH1D*) folder -> GetBackfolded() -> Clone("hBackfolded");
+
+  if (config.output.Length() > 0) folder -> Finish();
+  if (folder != _prepared) delete folder;
+
+  TH1::AddDirectory(addDir);
+  return result;
+
+}  // end 'Run(StJetFolderConfig&)'
+
+
+StJetFolder* StJetFolderSession::CreateFolder(const StJetFolderConfig &config) const {
+
+  StJetFolder *folder = new StJetFolder(config.output.Data(), _pearsonDebug);
+  folder -> SetInputs(_inputs);
+  folder -> SetPriorParameters(config.prior, config.bPrior, config.mPrior, config.nPrior, config.tPrior, config.priorMode);
+  folder -> SetUnfoldParameters(config.method, config.kReg, config.nMC, config.nToy, config.uMax, config.bMax, config.backMode);
+  folder -> SetThreads(config.nThread, config.seed);
+  folder -> SetCommonRandom(config.commonRandom);
+  folder -> SetResultsOnly(config.resultsOnly);
+  return folder;
+
+}  // end 'CreateFolder(StJetFolderConfig&)'
+
+
+Bool_t StJetFolderSession::IsPrepared(const StJetFolderConfig &a, const StJetFolderConfig &b) const {
+
+  // true if a folder initialized with 'b' can be shared by 'a'
+  // (kernel depends only on bMax)
+  if (a.bMax  != b.bMax)  return false;
+  if (a.prior != b.prior) return false;
+  if (a.prior == 0)       return true;
+
+  // regenerated priors depend on everything used in 'InitializePriors()'
+  Bool_t samePrior = true;
+  if (a.priorMode    != b.priorMode)    samePrior = false;
+  if (a.bPrior       != b.bPrior)       samePrior = false;
+  if (a.mPrior       != b.mPrior)       samePrior = false;
+  if (a.nPrior       != b.nPrior)       samePrior = false;
+  if (a.tPrior       != b.tPrior)       samePrior = false;
+  if (a.nMC          != b.nMC)          samePrior = false;
+  if (a.uMax         != b.uMax)         samePrior = false;
+  if (a.nThread      != b.nThread)      samePrior = false;
+  if (a.seed         != b.seed)         samePrior = false;
+  if (a.commonRandom != b.commonRandom) samePrior = false;
+  return samePrior;
+
+}  // end 'IsPrepared(StJetFolderConfig&, StJetFolderConfig&)'
+
+// End ------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+// 'StJetFolderSession.h'
+// Derek Anderson
+// 10.17.2026
+//
+// Runs many unfolding configurations on one set of inputs.  The
+// spectra are loaded (and the efficiency smoothed) once, into an
+// input folder; each call to 'Run(config)' then creates a folder
+// which shares those inputs (copying only the ones it changes, see
+// 'StJetFolder::OwnInput()').  The smearing kernel, regenerated
+// priors and RooUnfoldResponse from the last initialized folder are
+// reused whenever the next configuration has the same prior and
+// response settings (e.g. when only the method or k changes).
+//
+// A configuration with no output file only returns the results; one
+// with an output file also runs 'Finish()' and writes everything out
+// (only the numerical results if 'resultsOnly' is set; the plots can
+// then be made later with 'StJetFolder::Plot()').
+// The histograms in the returned result belong to the caller.
+// 'CreateFolder()' and 'IsPrepared()' let other drivers (e.g. the
+// scan in 'StJetFolderScan') do the same bookkeeping themselves.
+//
+// Last updated: 10.17.2026
+
+
+#ifndef StJetFolderSession_h
+#define StJetFolderSession_h
+
+// user includes
+#include "StJetFolder.h"
+
+using namespace std;
+
+
+
+class StJetFolderConfig {
+
+public:
+
+  StJetFolderConfig();
+  virtual ~StJetFolderConfig();
+
+  // prior parameters
+  Int_t    prior;
+  Int_t    priorMode;
+  Double_t bPrior;
+  Double_t mPrior;
+  Double_t nPrior;
+  Double_t tPrior;
+  // unfolding parameters
+  Int_t    method;
+  Int_t    kReg;
+  Int_t    nMC;
+  Int_t    nToy;
+  Int_t    backMode;
+  Double_t uMax;
+  Double_t bMax;
+  // threads
+  Int_t    nThread;
+  UInt_t   seed;
+  Bool_t   commonRandom;  // same random numbers for every configuration
+  // output file (empty = results only)
+  TString  output;
+  Bool_t   resultsOnly;
+
+
+  ClassDef(StJetFolderConfig, 3)
+
+};
+
+
+
+class StJetFolderResult {
+
+public:
+
+  StJetFolderResult();
+  virtual ~StJetFolderResult();
+
+  Double_t chi2unfold;
+  Double_t chi2backfold;
+  TH1D     *hUnfolded;
+  TH1D     *hBackfolded;
+
+
+  ClassDef(StJetFolderResult, 1)
+
+};
+
+
+
+class StJetFolderSession {
+
+public:
+
+  StJetFolderSession(const Bool_t pearDebug=Debug);
+  virtual ~StJetFolderSession();
+
+  // public methods (same as 'StJetFolder')
+  void SetPrior(const Char_t *pFile, const Char_t *pName);
+  void SetSmeared(const Char_t *sFile, const Char_t *sName);
+  void SetMeasured(const Char_t *mFile, const Char_t *mName);
+  void SetResponse(const Char_t *rFile, const Char_t *rName);
+  void SetEfficiency(const Char_t *eFile, const Char_t *eName, const Bool_t doSmoothing, const Bool_t removeErrors);
+  void SetEventInfo(const Int_t beam, const Double_t energy);
+  void SetTriggerInfo(const Int_t trigger, const Double_t eTmin, const Double_t eTmax, const Double_t hMax);
+  void SetJetInfo(const Int_t type, const Int_t nRM, const Double_t rJet, const Double_t aMin, const Double_t pTmin);
+  void LoadInputs(const StJetFolderManifest &manifest);
+  // public methods
+  void              Init();
+  StJetFolderResult Run(const StJetFolderConfig &config);
+  StJetFolder*      CreateFolder(const StJetFolderConfig &config) const;
+  Bool_t            IsPrepared(const StJetFolderConfig &a, const StJetFolderConfig &b) const;
+
+
+private:
+
+  // atomic members
+  Bool_t            _pearsonDebug;
+  Bool_t            _isInitialized;
+  // folders
+  StJetFolder       *_inputs;
+  StJetFolder       *_prepared;
+  StJetFolderConfig _prepConfig;
+
+
+  ClassDef(StJetFolderSession, 1)
+
+};
+
+
+#endif
+
+// End ------------------------------------------------------------------------
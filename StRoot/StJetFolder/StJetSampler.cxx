@@ -0,0 +1,185 @@
+// 'StJetSampler.cxx'
+// Derek Anderson
+// 10.17.2026
+//
+// Flat cumulative look-up tables for drawing random numbers from binned
+// distributions.  Sampling within a bin is uniform, exactly as in
+// TH1::GetRandom().
+//
+// Last updated: 10.17.2026
+
+
+#include "StJetSampler.h"
+
+ClassImp(StJetSampler)
+
+using namespace std;
+
+
+
+StJetSampler::StJetSampler() {
+
+  _nRows  = 0;
+  _nBins  = 0;
+  _nYbins = 0;
+  _xMax   = NoLimit;
+
+}  // end 'StJetSampler()'
+
+
+StJetSampler::~StJetSampler() {
+
+}  // end '~StJetSampler()'
+
+
+void StJetSampler::Build(const TH1 *h, const Double_t xMax) {
+
+  _xMax   = xMax;
+  _nBins  = h -> GetNbinsX();
+  _nYbins = 0;
+  _nRows  = 1;
+  SetEdges(h -> GetXaxis(), _xEdges);
+  _yEdges.clear();
+  _cdf.assign(_nRows * (_nBins + 1), 0.);
+  _uMax.assign(_nRows, 0.);
+
+  vector<Double_t> weights(_nBins, 0.);
+  for (Int_t iBin = 0; iBin < _nBins; iBin++) {
+    weights[iBin] = h -> GetBinContent(iBin + 1);
+  }
+  FillRow(0, weights);
+
+}  // end 'Build(TH1*, Double_t)'
+
+
+void StJetSampler::Build(const TH2 *h, const Double_t xMax) {
+
+  // one row per y-bin, including under- and overflow
+  _xMax   = xMax;
+  _nBins  = h -> GetNbinsX();
+  _nYbins = h -> GetNbinsY();
+  _nRows  = _nYbins + 2;
+  SetEdges(h -> GetXaxis(), _xEdges);
+  SetEdges(h -> GetYaxis(), _yEdges);
+  _cdf.assign(_nRows * (_nBins + 1), 0.);
+  _uMax.assign(_nRows, 0.);
+
+  vector<Double_t> weights(_nBins, 0.);
+  for (Int_t iRow = 0; iRow < _nRows; iRow++) {
+    for (Int_t iBin = 0; iBin < _nBins; iBin++) {
+      weights[iBin] = h -> GetBinContent(iBin + 1, iRow);
+    }
+    FillRow(iRow, weights);
+  }
+
+}  // end 'Build(TH2*, Double_t)'
+
+
+Int_t StJetSampler::FindRow(const Double_t y) const {
+
+  if (_yEdges.empty()) return 0;
+
+  // same convention as TAxis::FindBin(): 0 = underflow, nYbins + 1 = overflow
+  const Long64_t iEdge = TMath::BinarySearch((Long64_t) _yEdges.size(), &_yEdges[0], y);
+  return (Int_t) (iEdge + 1);
+
+}  // end 'FindRow(Double_t)'
+
+
+Bool_t StJetSampler::IsEmpty(const Int_t row) const {
+
+  if ((row < 0) || (row >= _nRows)) return true;
+  return (_uMax[row] <= 0.);
+
+}  // end 'IsEmpty(Int_t)'
+
+
+Double_t StJetSampler::Sample(const Int_t row, TRandom *rando) const {
+
+  // empty rows and rows entirely above xMax never draw
+  if (IsEmpty(row)) return NoSample;
+
+  const Double_t ran = rando -> Rndm();
+  if (ran > _uMax[row]) return NoSample;
+
+  const Double_t *cdf  = &_cdf[row * (_nBins + 1)];
+  Long64_t       iBin = TMath::BinarySearch((Long64_t) (_nBins + 1), cdf, ran);
+  if (iBin < 0)       iBin = 0;
+  if (iBin >= _nBins) iBin = _nBins - 1;
+
+  // uniform within bin, as in TH1::GetRandom()
+  const Double_t dCdf = cdf[iBin + 1] - cdf[iBin];
+  Double_t       x    = _xEdges[iBin];
+  if (dCdf > 0.) {
+    x += (_xEdges[iBin + 1] - _xEdges[iBin]) * (ran - cdf[iBin]) / dCdf;
+  }
+  return x;
+
+}  // end 'Sample(Int_t, TRandom*)'
+
+
+Double_t StJetSampler::GetProbability(const Int_t row, const Double_t xLo, const Double_t xHi) const {
+
+  if (IsEmpty(row)) return 0.;
+
+  // nothing is drawn above xMax
+  const Double_t lo   = (xLo < _xMax) ? xLo : _xMax;
+  const Double_t hi   = (xHi < _xMax) ? xHi : _xMax;
+  const Double_t prob = Cumulative(row, hi) - Cumulative(row, lo);
+  return (prob > 0.) ? prob : 0.;
+
+}  // end 'GetProbability(Int_t, Double_t, Double_t)'
+
+
+void StJetSampler::SetEdges(const TAxis *axis, vector<Double_t> &edges) {
+
+  const Int_t nEdges = axis -> GetNbins() + 1;
+  edges.resize(nEdges);
+  for (Int_t iEdge = 0; iEdge < nEdges; iEdge++) {
+    edges[iEdge] = axis -> GetBinLowEdge(iEdge + 1);
+  }
+
+}  // end 'SetEdges(TAxis*, vector<Double_t>&)'
+
+
+void StJetSampler::FillRow(const Int_t row, const vector<Double_t> &weights) {
+
+  Double_t *cdf = &_cdf[row * (_nBins + 1)];
+
+  // accumulate (negative bins can't be sampled)
+  cdf[0] = 0.;
+  for (Int_t iBin = 0; iBin < _nBins; iBin++) {
+    const Double_t w = (weights[iBin] > 0.) ? weights[iBin] : 0.;
+    cdf[iBin + 1] = cdf[iBin] + w;
+  }
+
+  const Double_t total = cdf[_nBins];
+  if (total <= 0.) {
+    _uMax[row] = 0.;
+    return;
+  }
+  for (Int_t iEdge = 1; iEdge < (_nBins + 1); iEdge++) {
+    cdf[iEdge] /= total;
+  }
+  cdf[_nBins] = 1.;
+
+  // cumulative value at xMax
+  _uMax[row] = Cumulative(row, _xMax);
+
+}  // end 'FillRow(Int_t, vector<Double_t>&)'
+
+
+Double_t StJetSampler::Cumulative(const Int_t row, const Double_t x) const {
+
+  if (x <= _xEdges[0])      return 0.;
+  if (x >= _xEdges[_nBins]) return 1.;
+
+  // linear within bin, consistent with uniform sampling
+  const Double_t *cdf  = &_cdf[row * (_nBins + 1)];
+  const Long64_t iBin = TMath::BinarySearch((Long64_t) (_nBins + 1), &_xEdges[0], x);
+  const Double_t frac = (x - _xEdges[iBin]) / (_xEdges[iBin + 1] - _xEdges[iBin]);
+  return cdf[iBin] + frac * (cdf[iBin + 1] - cdf[iBin]);
+
+}  // end 'Cumulative(Int_t, Double_t)'
+
+// End ------------------------------------------------------------------------
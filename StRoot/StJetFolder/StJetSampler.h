@@ -0,0 +1,83 @@
+// 'StJetSampler.h'
+// Derek Anderson
+// 10.17.2026
+//
+// Flat cumulative look-up tables for drawing random numbers from binned
+// distributions without going through TH1::GetRandom().  A table is
+// built once from either a 1D histogram (one row) or a 2D histogram
+// (one row per y-bin, including under- and overflow) and sampling is
+// then a binary search in the row's cumulative distribution, with no
+// allocations.  An optional upper limit on x is folded into the table:
+// draws landing above it return 'NoSample', as do draws from empty rows.
+// 'GetProbability()' gives the exact chance of a draw landing in a
+// given x-interval, for folding without sampling.
+//
+// Last updated: 10.17.2026
+
+
+#ifndef StJetSampler_h
+#define StJetSampler_h
+
+#include <vector>
+// ROOT includes
+#include "TH1.h"
+#include "TH2.h"
+#include "TMath.h"
+#include "TRandom.h"
+
+using namespace std;
+
+
+// global constants
+const Double_t NoSample = -1000.;
+const Double_t NoLimit  = 1.e30;
+
+
+
+class StJetSampler {
+
+public:
+
+  StJetSampler();
+  virtual ~StJetSampler();
+
+  // public methods
+  void     Build(const TH1 *h, const Double_t xMax=NoLimit);
+  void     Build(const TH2 *h, const Double_t xMax=NoLimit);
+  Int_t    FindRow(const Double_t y) const;
+  Int_t    GetNrows() const {return _nRows;}
+  Int_t    GetNbins() const {return _nBins;}
+  Bool_t   IsEmpty(const Int_t row) const;
+  Double_t Sample(const Int_t row, TRandom *rando) const;
+  Double_t Sample(TRandom *rando) const {return Sample(0, rando);}
+  Double_t SampleY(const Double_t y, TRandom *rando) const {return Sample(FindRow(y), rando);}
+  Double_t GetProbability(const Int_t row, const Double_t xLo, const Double_t xHi) const;
+
+
+private:
+
+  // atomic members
+  Int_t            _nRows;
+  Int_t            _nBins;
+  Int_t            _nYbins;
+  Double_t         _xMax;
+  // tables
+  vector<Double_t> _xEdges;  // x bin edges (nBins + 1)
+  vector<Double_t> _yEdges;  // y bin edges (nYbins + 1), empty for 1D
+  vector<Double_t> _cdf;     // normalized cumulative, nRows x (nBins + 1)
+  vector<Double_t> _uMax;    // per-row cumulative value at xMax (0 if row empty)
+
+  // private methods
+  void     SetEdges(const TAxis *axis, vector<Double_t> &edges);
+  void     FillRow(const Int_t row, const vector<Double_t> &weights);
+  Double_t Cumulative(const Int_t row, const Double_t x) const;
+
+
+  ClassDef(StJetSampler, 1)
+
+};
+
+
+#endif
+
+// End ------------------------------------------------------------------------